@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//-----------------------------------------------------------------------------
+// AsyncOperation
+// Status of one operation a PluginHost runs on the message thread (load,
+// loadState, program, blockSize, ...), shared between the steps doing the work
+// and the PluginOp object handed to the shreds. The steps record failures and
+// check for cancellation, the operation is finished once the last step lets go
+// of it. The status is published last, so once it's no longer pending the error
+// message can be read from any thread.
+//-----------------------------------------------------------------------------
+class AsyncOperation
+{
+public:
+
+    enum Status
+    {
+        pending = 0,
+        done,
+        failed,
+        cancelled
+    };
+
+    AsyncOperation() : m_id(nextId()) {}
+
+    AsyncOperation(const AsyncOperation&) = delete;
+    AsyncOperation& operator=(const AsyncOperation&) = delete;
+
+    // unique across all hosts
+    int64_t getId() const { return m_id; }
+
+    Status getStatus() const { return (Status)m_status.load(std::memory_order_acquire); }
+    bool isFinished() const { return getStatus() != pending; }
+
+    // why the operation failed (only valid once it's finished)
+    const std::string& getError() const { return m_error; }
+
+    // Ask the operation to stop at its next step, false if it's finished already (any thread)
+    // A step already running completes, so a cancelled operation may still end up done.
+    bool cancel()
+    {
+        if (isFinished())
+            return false;
+        m_cancelRequested.store(true);
+        return true;
+    }
+
+    // checked at the start of each step, true if the step should return without doing anything
+    bool shouldStop()
+    {
+        if (!m_cancelRequested.load())
+            return false;
+        m_stopped = true;
+        return true;
+    }
+
+    // the first failure is the one reported
+    void fail(const std::string& error)
+    {
+        if (m_failed)
+            return;
+        m_error = error;
+        m_failed = true;
+    }
+
+    // called once the last step is done
+    void finish()
+    {
+        m_status.store(m_failed ? failed : m_stopped ? cancelled : done, std::memory_order_release);
+    }
+
+private:
+
+    static int64_t nextId()
+    {
+        static std::atomic<int64_t> id { 0 };
+        return ++id;
+    }
+
+    const int64_t m_id;
+    std::atomic<int> m_status { pending };
+    std::atomic<bool> m_cancelRequested { false };
+    // written by the steps, which run one after the other
+    bool m_failed = false;
+    bool m_stopped = false;
+    std::string m_error;
+};
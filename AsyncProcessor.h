@@ -0,0 +1,189 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ParallelScheduler.h"
+#include "PluginChain.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+//-----------------------------------------------------------------------------
+// AsyncProcessor
+// Runs a plugin chain's processBlock calls off the audio thread, one block ahead of it.
+// Each call to process() hands the current block to a worker and swaps in the
+// result of the previous one, so exactly one block of latency is traded for
+// moving the plugin's DSP off the ChucK VM thread. The worker is either a
+// dedicated realtime thread or the shared ParallelScheduler pool.
+// The two slots are double buffered and handed over with an atomic pointer.
+// The audio thread only waits a bounded time for a late worker (waitForBlock),
+// the host skips the block if it's still busy.
+//-----------------------------------------------------------------------------
+class AsyncProcessor : private ParallelScheduler::Job
+{
+public:
+
+    // without a scheduler the processor starts its own worker thread
+    AsyncProcessor(int numChannels, int maxBlockSize, double sampleRate, std::shared_ptr<ParallelScheduler> scheduler = nullptr)
+        : m_scheduler(std::move(scheduler)), m_maxBlockSize(maxBlockSize), m_sampleRate(sampleRate)
+    {
+        for (auto& slot : m_slots)
+        {
+            slot.audio.setSize(numChannels, maxBlockSize);
+            slot.audio.clear();
+            // enough for dense MIDI, addEvents won't have to allocate on the audio thread
+            slot.midi.ensureSize(4096);
+        }
+
+        if (!m_scheduler)
+        {
+            m_thread = std::make_unique<DedicatedThread>(*this);
+            const auto options = juce::Thread::RealtimeOptions().withApproximateAudioProcessingTime(maxBlockSize, sampleRate);
+            if (!m_thread->startRealtimeThread(options))
+                m_thread->startThread(juce::Thread::Priority::highest);
+        }
+    }
+
+    ~AsyncProcessor() override
+    {
+        if (m_thread)
+        {
+            m_thread->signalThreadShouldExit();
+            m_thread->jobReady.signal();
+            m_thread->stopThread(1000);
+        }
+        // a queued job must not outlive us
+        waitUntilIdle();
+    }
+
+    // whether this processor has room for the given buffer dimensions and runs on the given scheduler
+    bool canProcess(int numChannels, int numSamples, const ParallelScheduler* scheduler) const
+    {
+        return numChannels <= m_slots[0].audio.getNumChannels() && numSamples <= m_maxBlockSize
+            && scheduler == m_scheduler.get();
+    }
+
+    // Hand buffer/midi to the worker and replace them with the previous block's result (audio thread)
+    // Only while the worker is idle (see waitForBlock). The first block after creation comes back silent.
+    // The plugin list must stay alive (and unchanged) until the processor is idle again.
+    void process(const PluginList& plugins, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+    {
+        jassert(isIdle());
+        const int numChannels = std::min(buffer.getNumChannels(), m_slots[0].audio.getNumChannels());
+        const int numSamples = std::min(buffer.getNumSamples(), m_maxBlockSize);
+
+        Slot& next = m_slots[m_current];
+        Slot& previous = m_slots[1 - m_current];
+        m_current = 1 - m_current;
+
+        // submit the current block
+        for (int c = 0; c < numChannels; c++)
+            juce::FloatVectorOperations::copy(next.audio.getWritePointer(c), buffer.getReadPointer(c), numSamples);
+        next.midi.clear();
+        next.midi.addEvents(midi, 0, numSamples, 0);
+        next.numSamples = numSamples;
+        next.plugins = &plugins;
+
+        m_job.store(&next);
+        if (m_thread)
+            m_thread->jobReady.signal();
+        else if (!m_scheduler->submit(*this))
+            run(); // no room in the pool, process inline
+
+        // return the previous block's result
+        const int numReady = std::min(previous.numSamples, numSamples);
+        for (int c = 0; c < numChannels; c++)
+        {
+            juce::FloatVectorOperations::copy(buffer.getWritePointer(c), previous.audio.getReadPointer(c), numReady);
+            juce::FloatVectorOperations::clear(buffer.getWritePointer(c, numReady), buffer.getNumSamples() - numReady);
+        }
+        midi.swapWith(previous.midi);
+    }
+
+    bool isIdle() const { return m_job.load() == nullptr; }
+
+    // Wait for the worker to finish the previous block before a block of numSamples is processed (audio thread)
+    // It had a whole block's worth of time already and is normally done, a late worker gets at most
+    // maxWaitBlocks of a block more. Returns false if it's still busy, the block has to be skipped then.
+    bool waitForBlock(int numSamples) const
+    {
+        if (isIdle())
+            return true;
+
+        const double deadline = juce::Time::getMillisecondCounterHiRes() + 1000.0 * maxWaitBlocks * numSamples / m_sampleRate;
+        while (!isIdle())
+        {
+            if (juce::Time::getMillisecondCounterHiRes() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // spin until the worker has finished its current block, if any (never on the audio thread)
+    void waitUntilIdle() const
+    {
+        while (!isIdle())
+            std::this_thread::yield();
+    }
+
+private:
+
+    static constexpr double maxWaitBlocks = 0.25;
+
+    // process the submitted block, if any (worker thread)
+    void run() override
+    {
+        if (Slot* slot = m_job.load())
+        {
+            juce::AudioBuffer<float> block(slot->audio.getArrayOfWritePointers(), slot->audio.getNumChannels(), slot->numSamples);
+            processPluginChain(*slot->plugins, block, slot->midi);
+            m_job.store(nullptr);
+        }
+    }
+
+    class DedicatedThread : public juce::Thread
+    {
+    public:
+        DedicatedThread(AsyncProcessor& owner) : juce::Thread("PluginHost Async Processor"), m_owner(owner) {}
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (m_owner.m_job.load() != nullptr)
+                    m_owner.run();
+                else
+                    jobReady.wait(100);
+            }
+        }
+
+        // wakes the thread up when a job is submitted
+        juce::WaitableEvent jobReady;
+
+    private:
+        AsyncProcessor& m_owner;
+    };
+
+    struct Slot
+    {
+        juce::AudioBuffer<float> audio;
+        juce::MidiBuffer midi;
+        int numSamples = 0;
+        const PluginList* plugins = nullptr;
+    };
+
+    // slots alternate between being processed and being read back
+    Slot m_slots[2];
+    // slot the next block goes into (audio thread only)
+    int m_current = 0;
+    // slot the worker is processing, null when idle
+    std::atomic<Slot*> m_job { nullptr };
+    // shared pool the blocks are submitted to, or null when using m_thread
+    std::shared_ptr<ParallelScheduler> m_scheduler;
+    std::unique_ptr<DedicatedThread> m_thread;
+    int m_maxBlockSize = 0;
+    double m_sampleRate = 44100.0;
+};
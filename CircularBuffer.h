@@ -2,134 +2,214 @@
 
 #include <JuceHeader.h>
 
+#include "Interleave.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// CircularBuffer
+// Multichannel FIFO which wraps a juce::AudioBuffer. The capacity is rounded up to a
+// power of two so that positions can be masked instead of wrapped with %, and all
+// transfers are done in bulk: every push/pop splits at the wrap point into at most
+// two contiguous spans which are copied with memcpy (or the interleave kernels).
+// Single threaded - used by the audio thread only.
+//-----------------------------------------------------------------------------
 class CircularBuffer
 {
 public:
 
-    CircularBuffer(int numChannels, int size)
-        : buffer(numChannels, size), writeIndex(0), readIndex(0)
+    CircularBuffer(int numChannels, int minCapacity)
     {
-        buffer.clear();
+        setSize(numChannels, minCapacity);
     }
 
-    void setSize(int numChannels, int size)
+    // allocates, don't call from the audio thread
+    void setSize(int numChannels, int minCapacity)
     {
-        buffer.setSize(numChannels, size);
+        const int capacity = juce::nextPowerOfTwo(std::max(1, minCapacity));
+        buffer.setSize(numChannels, capacity);
+        mask = (uint32_t)capacity - 1;
+        spanPointers.resize((size_t)numChannels);
         clear();
     }
 
     void clear()
     {
         buffer.clear();
-        writeIndex = 0;
-        readIndex = 0;
+        writePos = 0;
+        readPos = 0;
+    }
+
+    int getNumChannels() const { return buffer.getNumChannels(); }
+    int getCapacity() const { return (int)mask + 1; }
+
+    // positions increase monotonically (wrapping at 2^32), so the difference is always the fill level
+    int getAvailableSamples() const { return (int)(writePos - readPos); }
+    int getFreeSpace() const { return getCapacity() - getAvailableSamples(); }
+
+    //-------------------------------------------------------------------------
+    // planar transfers
+    //-------------------------------------------------------------------------
+    // Push numSamples from each of numChannels planar channels
+    // Returns false (and pushes nothing) if there isn't enough space
+    bool push(const float* const* source, int numChannels, int numSamples)
+    {
+        if (getFreeSpace() < numSamples) return false; // Overflow protection
+
+        numChannels = std::min(numChannels, buffer.getNumChannels());
+        forEachSpan(writePos, numSamples, [&](int bufferStart, int offset, int length)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                std::memcpy(buffer.getWritePointer(ch, bufferStart), source[ch] + offset, sizeof(float) * (size_t)length);
+        });
+
+        writePos += (uint32_t)numSamples;
+        return true;
+    }
+
+    // For pushing block (output from plugin)
+    bool push(const juce::AudioBuffer<float>& source)
+    {
+        return push(source.getArrayOfReadPointers(), source.getNumChannels(), source.getNumSamples());
     }
 
-    void push(float* input, int numChannels)
+    // Pop numSamples into each of numChannels planar channels
+    // Returns false (and pops nothing) if not enough samples are available
+    bool pop(float* const* destination, int numChannels, int numSamples)
     {
-        for (int ch = 0; ch < numChannels && ch < buffer.getNumChannels(); ++ch)
+        if (getAvailableSamples() < numSamples) return false;
+
+        numChannels = std::min(numChannels, buffer.getNumChannels());
+        forEachSpan(readPos, numSamples, [&](int bufferStart, int offset, int length)
         {
-            buffer.setSample(ch, writeIndex, input[ch]);
-        }
-        
-        writeIndex = (writeIndex + 1) % buffer.getNumSamples();
+            for (int ch = 0; ch < numChannels; ++ch)
+                std::memcpy(destination[ch] + offset, buffer.getReadPointer(ch, bufferStart), sizeof(float) * (size_t)length);
+        });
+
+        readPos += (uint32_t)numSamples;
+        return true;
     }
 
     // Fills the destination buffer with accumulated samples
     // Returns true if enough samples were available to fill the buffer
     bool pop(juce::AudioBuffer<float>& destination)
     {
-        int samplesNeeded = destination.getNumSamples();
-        int availableSamples = getAvailableSamples();
+        return pop(destination.getArrayOfWritePointers(), destination.getNumChannels(), destination.getNumSamples());
+    }
 
-        if (availableSamples < samplesNeeded)
-            return false;
+    // Push numSamples of silence, e.g. to prime a delay line
+    // Returns false (and pushes nothing) if there isn't enough space
+    bool pushSilence(int numSamples)
+    {
+        if (getFreeSpace() < numSamples) return false;
 
-        for (int ch = 0; ch < destination.getNumChannels() && ch < buffer.getNumChannels(); ++ch)
+        forEachSpan(writePos, numSamples, [&](int bufferStart, int, int length)
         {
-            auto* dest = destination.getWritePointer(ch);
-            auto* src = buffer.getReadPointer(ch);
-            
-            for (int i = 0; i < samplesNeeded; ++i)
-            {
-                int idx = (readIndex + i) % buffer.getNumSamples();
-                dest[i] = src[idx];
-            }
-        }
-
-        readIndex = (readIndex + samplesNeeded) % buffer.getNumSamples();
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                std::memset(buffer.getWritePointer(ch, bufferStart), 0, sizeof(float) * (size_t)length);
+        });
+
+        writePos += (uint32_t)numSamples;
         return true;
     }
-    
-    // Writes samples from source buffer back into the circular buffer
-    // This is used to push processed samples back
-    void writeBack(const juce::AudioBuffer<float>& source)
-    {
-        int numSamples = source.getNumSamples();
-        // We write back to where we just read from (effectively overwriting or appending? 
-        // Wait, for a simple accumulation strategy we usually:
-        // 1. Push single samples into input circular buffer
-        // 2. When enough samples, process block
-        // 3. Push processed block into output circular buffer
-        // 4. Pop single sample from output circular buffer
-        
-        // The user asked for "a simple circular buffer which wraps a juce::AudioBuffer".
-        // I'll stick to basic push/pop functionality. 
-        // The logic for handling input vs output buffering will be in PluginHost.cpp
-    }
-    
-    int getAvailableSamples() const
+
+    // Push numSamples of the same frame (one value per channel), e.g. a control signal sampled once
+    // Returns false (and pushes nothing) if there isn't enough space
+    bool pushHeld(const float* frame, int numChannels, int numSamples)
     {
-        int size = buffer.getNumSamples();
-        if (writeIndex >= readIndex)
-            return writeIndex - readIndex;
-        else
-            return size - (readIndex - writeIndex);
+        if (getFreeSpace() < numSamples) return false;
+
+        numChannels = std::min(numChannels, buffer.getNumChannels());
+        forEachSpan(writePos, numSamples, [&](int bufferStart, int, int length)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                std::fill_n(buffer.getWritePointer(ch, bufferStart), length, frame[ch]);
+        });
+
+        writePos += (uint32_t)numSamples;
+        return true;
     }
 
-    int getFreeSpace() const
+    // Move as many samples as fit from another buffer into this one (used when swapping buffers)
+    // Channels which only exist in one of the two buffers are dropped / left silent
+    void transferFrom(CircularBuffer& source)
     {
-        return buffer.getNumSamples() - 1 - getAvailableSamples();
+        const int numSamples = std::min(source.getAvailableSamples(), getFreeSpace());
+        const int numChannels = std::min(source.getNumChannels(), buffer.getNumChannels());
+
+        source.forEachSpan(source.readPos, numSamples, [&](int bufferStart, int, int length)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                source.spanPointers[(size_t)ch] = source.buffer.getWritePointer(ch, bufferStart);
+            push(source.spanPointers.data(), numChannels, length);
+        });
+
+        source.readPos += (uint32_t)numSamples;
     }
-    
-    // For popping single sample (output)
-    void pop(float* output, int numChannels)
+
+    //-------------------------------------------------------------------------
+    // interleaved transfers (ChucK frames, `stride` floats apart)
+    //-------------------------------------------------------------------------
+    // Push numFrames interleaved frames, returns false (and pushes nothing) if there isn't enough space
+    bool pushInterleaved(const float* input, int stride, int numChannels, int numFrames)
     {
-        if (getAvailableSamples() == 0)
+        if (getFreeSpace() < numFrames) return false;
+
+        numChannels = std::min(numChannels, buffer.getNumChannels());
+        forEachSpan(writePos, numFrames, [&](int bufferStart, int offset, int length)
         {
-            for(int i=0; i < numChannels; i++)
-                output[i] = 0.0f;
-            return;
-        }
-
-        for (int ch = 0; ch < std::min(numChannels, buffer.getNumChannels()); ++ch)
-            output[ch] = buffer.getSample(ch, readIndex);
-        
-        readIndex = (readIndex + 1) % buffer.getNumSamples();
+            for (int ch = 0; ch < numChannels; ++ch)
+                spanPointers[(size_t)ch] = buffer.getWritePointer(ch, bufferStart);
+            interleave::deinterleave(input + offset * stride, stride, spanPointers.data(), numChannels, length);
+        });
+
+        writePos += (uint32_t)numFrames;
+        return true;
     }
-    
-    // For pushing block (output from plugin)
-    void push(const juce::AudioBuffer<float>& source)
+
+    // Pop numFrames into interleaved frames. If fewer are available the rest of the frames are zeroed
+    // (only the first numChannels floats of each frame are written)
+    void popInterleaved(float* output, int stride, int numChannels, int numFrames)
     {
-        int numSamples = source.getNumSamples();
-        if (getFreeSpace() < numSamples) return; // Overflow protection
-        
-        for (int ch = 0; ch < source.getNumChannels() && ch < buffer.getNumChannels(); ++ch)
+        numChannels = std::min(numChannels, buffer.getNumChannels());
+        const int numToRead = std::min(numFrames, getAvailableSamples());
+
+        forEachSpan(readPos, numToRead, [&](int bufferStart, int offset, int length)
         {
-            auto* src = source.getReadPointer(ch);
-            
-            for (int i = 0; i < numSamples; ++i)
-            {
-                int idx = (writeIndex + i) % buffer.getNumSamples();
-                buffer.setSample(ch, idx, src[i]);
-            }
-        }
-        writeIndex = (writeIndex + numSamples) % buffer.getNumSamples();
+            for (int ch = 0; ch < numChannels; ++ch)
+                spanPointers[(size_t)ch] = buffer.getWritePointer(ch, bufferStart);
+            interleave::interleave(spanPointers.data(), output + offset * stride, stride, numChannels, length);
+        });
+        readPos += (uint32_t)numToRead;
+
+        // underflow
+        for (int f = numToRead; f < numFrames; f++)
+            for (int ch = 0; ch < numChannels; ch++)
+                output[f * stride + ch] = 0.0f;
     }
 
 private:
 
+    // Calls func(bufferStart, offset, length) for the (at most two) contiguous spans
+    // covering numSamples starting at position pos
+    template <typename Func>
+    void forEachSpan(uint32_t pos, int numSamples, Func&& func) const
+    {
+        if (numSamples <= 0) return;
+
+        const int start = (int)(pos & mask);
+        const int first = std::min(numSamples, getCapacity() - start);
+        func(start, 0, first);
+        if (first < numSamples)
+            func(0, first, numSamples - first);
+    }
+
     juce::AudioBuffer<float> buffer;
-    int writeIndex;
-    int readIndex;
+    // span channel pointers for the interleave kernels (preallocated)
+    std::vector<float*> spanPointers;
+    uint32_t mask = 0;
+    uint32_t writePos = 0;
+    uint32_t readPos = 0;
 };
@@ -0,0 +1,364 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Interleave.h
+// Transpose kernels between ChucK's interleaved frames and JUCE's planar channels.
+// Kernels are templated on the channel count so that the inner loops fully unroll,
+// and use SSE/AVX2/NEON where available. `stride` is the number of floats per
+// interleaved frame, which may be larger than the number of channels copied.
+// Does not depend on JUCE so that it can be benchmarked standalone.
+//-----------------------------------------------------------------------------
+
+#include <cstring>
+
+#if defined(__AVX2__)
+    #define PLUGINHOST_INTERLEAVE_AVX2 1
+    #include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PLUGINHOST_INTERLEAVE_SSE 1
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define PLUGINHOST_INTERLEAVE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace interleave
+{
+
+//-----------------------------------------------------------------------------
+// scalar reference implementation
+//-----------------------------------------------------------------------------
+namespace scalar
+{
+    template <int NumChannels>
+    inline void deinterleave(const float* in, int stride, float* const* dest, int startFrame, int numFrames)
+    {
+        for (int c = 0; c < NumChannels; c++)
+        {
+            float* d = dest[c];
+            for (int f = startFrame; f < numFrames; f++)
+                d[f] = in[f * stride + c];
+        }
+    }
+
+    template <int NumChannels>
+    inline void interleave(const float* const* src, float* out, int stride, int startFrame, int numFrames)
+    {
+        for (int c = 0; c < NumChannels; c++)
+        {
+            const float* s = src[c];
+            for (int f = startFrame; f < numFrames; f++)
+                out[f * stride + c] = s[f];
+        }
+    }
+
+    inline void deinterleave(const float* in, int stride, float* const* dest, int numChannels, int numFrames)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* d = dest[c];
+            for (int f = 0; f < numFrames; f++)
+                d[f] = in[f * stride + c];
+        }
+    }
+
+    inline void interleave(const float* const* src, float* out, int stride, int numChannels, int numFrames)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            const float* s = src[c];
+            for (int f = 0; f < numFrames; f++)
+                out[f * stride + c] = s[f];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// SIMD helpers
+//-----------------------------------------------------------------------------
+namespace detail
+{
+#if PLUGINHOST_INTERLEAVE_SSE
+    // 4x4 transpose of four rows starting at the given pointers, stored to four other pointers
+    inline void transpose4(const float* r0, const float* r1, const float* r2, const float* r3,
+                           float* c0, float* c1, float* c2, float* c3)
+    {
+        __m128 a = _mm_loadu_ps(r0), b = _mm_loadu_ps(r1), c = _mm_loadu_ps(r2), d = _mm_loadu_ps(r3);
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        _mm_storeu_ps(c0, a); _mm_storeu_ps(c1, b); _mm_storeu_ps(c2, c); _mm_storeu_ps(c3, d);
+    }
+#elif PLUGINHOST_INTERLEAVE_NEON
+    inline void transpose4(const float* r0, const float* r1, const float* r2, const float* r3,
+                           float* c0, float* c1, float* c2, float* c3)
+    {
+        const float32x4x2_t t01 = vtrnq_f32(vld1q_f32(r0), vld1q_f32(r1));
+        const float32x4x2_t t23 = vtrnq_f32(vld1q_f32(r2), vld1q_f32(r3));
+        vst1q_f32(c0, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+        vst1q_f32(c1, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+        vst1q_f32(c2, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+        vst1q_f32(c3, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+    }
+#endif
+
+#if PLUGINHOST_INTERLEAVE_AVX2
+    // 8x8 transpose, rows are 8 floats `rowStride` apart, columns are written to cols[0..7] + offset
+    inline void transpose8(const float* rows, int rowStride, float* const* cols, int offset)
+    {
+        const __m256 r0 = _mm256_loadu_ps(rows + 0 * rowStride), r1 = _mm256_loadu_ps(rows + 1 * rowStride);
+        const __m256 r2 = _mm256_loadu_ps(rows + 2 * rowStride), r3 = _mm256_loadu_ps(rows + 3 * rowStride);
+        const __m256 r4 = _mm256_loadu_ps(rows + 4 * rowStride), r5 = _mm256_loadu_ps(rows + 5 * rowStride);
+        const __m256 r6 = _mm256_loadu_ps(rows + 6 * rowStride), r7 = _mm256_loadu_ps(rows + 7 * rowStride);
+
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+        const __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+        const __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+        const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        _mm256_storeu_ps(cols[0] + offset, _mm256_permute2f128_ps(u0, u4, 0x20));
+        _mm256_storeu_ps(cols[1] + offset, _mm256_permute2f128_ps(u1, u5, 0x20));
+        _mm256_storeu_ps(cols[2] + offset, _mm256_permute2f128_ps(u2, u6, 0x20));
+        _mm256_storeu_ps(cols[3] + offset, _mm256_permute2f128_ps(u3, u7, 0x20));
+        _mm256_storeu_ps(cols[4] + offset, _mm256_permute2f128_ps(u0, u4, 0x31));
+        _mm256_storeu_ps(cols[5] + offset, _mm256_permute2f128_ps(u1, u5, 0x31));
+        _mm256_storeu_ps(cols[6] + offset, _mm256_permute2f128_ps(u2, u6, 0x31));
+        _mm256_storeu_ps(cols[7] + offset, _mm256_permute2f128_ps(u3, u7, 0x31));
+    }
+
+    // inverse of transpose8, column c frame f is written to out[f * stride + c]
+    inline void untranspose8(const float* const* cols, int offset, float* out, int stride)
+    {
+        float* rows[8];
+        for (int f = 0; f < 8; f++)
+            rows[f] = out + f * stride;
+
+        // an 8x8 transpose is its own inverse, gather the columns as rows first
+        const __m256 r0 = _mm256_loadu_ps(cols[0] + offset), r1 = _mm256_loadu_ps(cols[1] + offset);
+        const __m256 r2 = _mm256_loadu_ps(cols[2] + offset), r3 = _mm256_loadu_ps(cols[3] + offset);
+        const __m256 r4 = _mm256_loadu_ps(cols[4] + offset), r5 = _mm256_loadu_ps(cols[5] + offset);
+        const __m256 r6 = _mm256_loadu_ps(cols[6] + offset), r7 = _mm256_loadu_ps(cols[7] + offset);
+
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+        const __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+        const __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+        const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        _mm256_storeu_ps(rows[0], _mm256_permute2f128_ps(u0, u4, 0x20));
+        _mm256_storeu_ps(rows[1], _mm256_permute2f128_ps(u1, u5, 0x20));
+        _mm256_storeu_ps(rows[2], _mm256_permute2f128_ps(u2, u6, 0x20));
+        _mm256_storeu_ps(rows[3], _mm256_permute2f128_ps(u3, u7, 0x20));
+        _mm256_storeu_ps(rows[4], _mm256_permute2f128_ps(u0, u4, 0x31));
+        _mm256_storeu_ps(rows[5], _mm256_permute2f128_ps(u1, u5, 0x31));
+        _mm256_storeu_ps(rows[6], _mm256_permute2f128_ps(u2, u6, 0x31));
+        _mm256_storeu_ps(rows[7], _mm256_permute2f128_ps(u3, u7, 0x31));
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// deinterleave: in[f * stride + c] -> dest[c][f]
+//-----------------------------------------------------------------------------
+template <int NumChannels>
+inline void deinterleave(const float* in, int stride, float* const* dest, int numFrames)
+{
+    static_assert(NumChannels == 1 || NumChannels == 2 || NumChannels == 4 || NumChannels == 8,
+                  "unsupported channel count, use the runtime overload");
+
+    int f = 0;
+
+    if constexpr (NumChannels == 1)
+    {
+        if (stride == 1)
+        {
+            std::memcpy(dest[0], in, sizeof(float) * (size_t)numFrames);
+            return;
+        }
+    }
+#if PLUGINHOST_INTERLEAVE_SSE
+    else if constexpr (NumChannels == 2)
+    {
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            const float* r = in + f * stride;
+            __m128 a = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(r));
+            a = _mm_loadh_pi(a, (const __m64*)(r + stride));
+            __m128 b = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(r + 2 * stride));
+            b = _mm_loadh_pi(b, (const __m64*)(r + 3 * stride));
+            _mm_storeu_ps(dest[0] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(dest[1] + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+#elif PLUGINHOST_INTERLEAVE_NEON
+    else if constexpr (NumChannels == 2)
+    {
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            const float* r = in + f * stride;
+            const float32x4_t a = vcombine_f32(vld1_f32(r), vld1_f32(r + stride));
+            const float32x4_t b = vcombine_f32(vld1_f32(r + 2 * stride), vld1_f32(r + 3 * stride));
+            const float32x4x2_t c = vuzpq_f32(a, b);
+            vst1q_f32(dest[0] + f, c.val[0]);
+            vst1q_f32(dest[1] + f, c.val[1]);
+        }
+    }
+#endif
+#if PLUGINHOST_INTERLEAVE_SSE || PLUGINHOST_INTERLEAVE_NEON
+    else if constexpr (NumChannels == 4)
+    {
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            const float* r = in + f * stride;
+            detail::transpose4(r, r + stride, r + 2 * stride, r + 3 * stride,
+                               dest[0] + f, dest[1] + f, dest[2] + f, dest[3] + f);
+        }
+    }
+    else if constexpr (NumChannels == 8)
+    {
+    #if PLUGINHOST_INTERLEAVE_AVX2
+        for (; f + 8 <= numFrames; f += 8)
+            detail::transpose8(in + f * stride, stride, dest, f);
+    #endif
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            const float* r = in + f * stride;
+            detail::transpose4(r, r + stride, r + 2 * stride, r + 3 * stride,
+                               dest[0] + f, dest[1] + f, dest[2] + f, dest[3] + f);
+            detail::transpose4(r + 4, r + stride + 4, r + 2 * stride + 4, r + 3 * stride + 4,
+                               dest[4] + f, dest[5] + f, dest[6] + f, dest[7] + f);
+        }
+    }
+#endif
+
+    // remaining frames
+    scalar::deinterleave<NumChannels>(in, stride, dest, f, numFrames);
+}
+
+//-----------------------------------------------------------------------------
+// interleave: src[c][f] -> out[f * stride + c]
+// only the first NumChannels floats of every frame are written
+//-----------------------------------------------------------------------------
+template <int NumChannels>
+inline void interleave(const float* const* src, float* out, int stride, int numFrames)
+{
+    static_assert(NumChannels == 1 || NumChannels == 2 || NumChannels == 4 || NumChannels == 8,
+                  "unsupported channel count, use the runtime overload");
+
+    int f = 0;
+
+    if constexpr (NumChannels == 1)
+    {
+        if (stride == 1)
+        {
+            std::memcpy(out, src[0], sizeof(float) * (size_t)numFrames);
+            return;
+        }
+    }
+#if PLUGINHOST_INTERLEAVE_SSE
+    else if constexpr (NumChannels == 2)
+    {
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            float* r = out + f * stride;
+            const __m128 c0 = _mm_loadu_ps(src[0] + f);
+            const __m128 c1 = _mm_loadu_ps(src[1] + f);
+            const __m128 lo = _mm_unpacklo_ps(c0, c1);
+            const __m128 hi = _mm_unpackhi_ps(c0, c1);
+            _mm_storel_pi((__m64*)(r), lo);
+            _mm_storeh_pi((__m64*)(r + stride), lo);
+            _mm_storel_pi((__m64*)(r + 2 * stride), hi);
+            _mm_storeh_pi((__m64*)(r + 3 * stride), hi);
+        }
+    }
+#elif PLUGINHOST_INTERLEAVE_NEON
+    else if constexpr (NumChannels == 2)
+    {
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            float* r = out + f * stride;
+            const float32x4x2_t z = vzipq_f32(vld1q_f32(src[0] + f), vld1q_f32(src[1] + f));
+            vst1_f32(r, vget_low_f32(z.val[0]));
+            vst1_f32(r + stride, vget_high_f32(z.val[0]));
+            vst1_f32(r + 2 * stride, vget_low_f32(z.val[1]));
+            vst1_f32(r + 3 * stride, vget_high_f32(z.val[1]));
+        }
+    }
+#endif
+#if PLUGINHOST_INTERLEAVE_SSE || PLUGINHOST_INTERLEAVE_NEON
+    else if constexpr (NumChannels == 4)
+    {
+        // a 4x4 transpose is its own inverse
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            float* r = out + f * stride;
+            detail::transpose4(src[0] + f, src[1] + f, src[2] + f, src[3] + f,
+                               r, r + stride, r + 2 * stride, r + 3 * stride);
+        }
+    }
+    else if constexpr (NumChannels == 8)
+    {
+    #if PLUGINHOST_INTERLEAVE_AVX2
+        for (; f + 8 <= numFrames; f += 8)
+            detail::untranspose8(src, f, out + f * stride, stride);
+    #endif
+        for (; f + 4 <= numFrames; f += 4)
+        {
+            float* r = out + f * stride;
+            detail::transpose4(src[0] + f, src[1] + f, src[2] + f, src[3] + f,
+                               r, r + stride, r + 2 * stride, r + 3 * stride);
+            detail::transpose4(src[4] + f, src[5] + f, src[6] + f, src[7] + f,
+                               r + 4, r + stride + 4, r + 2 * stride + 4, r + 3 * stride + 4);
+        }
+    }
+#endif
+
+    // remaining frames
+    scalar::interleave<NumChannels>(src, out, stride, f, numFrames);
+}
+
+//-----------------------------------------------------------------------------
+// runtime dispatch on channel count
+//-----------------------------------------------------------------------------
+inline void deinterleave(const float* in, int stride, float* const* dest, int numChannels, int numFrames)
+{
+    switch (numChannels)
+    {
+        case 1: deinterleave<1>(in, stride, dest, numFrames); break;
+        case 2: deinterleave<2>(in, stride, dest, numFrames); break;
+        case 4: deinterleave<4>(in, stride, dest, numFrames); break;
+        case 8: deinterleave<8>(in, stride, dest, numFrames); break;
+        default: scalar::deinterleave(in, stride, dest, numChannels, numFrames); break;
+    }
+}
+
+inline void interleave(const float* const* src, float* out, int stride, int numChannels, int numFrames)
+{
+    switch (numChannels)
+    {
+        case 1: interleave<1>(src, out, stride, numFrames); break;
+        case 2: interleave<2>(src, out, stride, numFrames); break;
+        case 4: interleave<4>(src, out, stride, numFrames); break;
+        case 8: interleave<8>(src, out, stride, numFrames); break;
+        default: scalar::interleave(src, out, stride, numChannels, numFrames); break;
+    }
+}
+
+}
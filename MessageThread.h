@@ -0,0 +1,218 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// The message loop can only run on a thread of the chugin's own where JUCE allows it (Linux),
+// everywhere else it's pumped from ChucK's main thread hook. See PLUGINHOST_MESSAGE_THREAD in CMakeLists.txt.
+#if defined(PLUGINHOST_MESSAGE_THREAD) && PLUGINHOST_MESSAGE_THREAD && JUCE_LINUX
+ #define PLUGINHOST_OWN_MESSAGE_THREAD 1
+#else
+ #define PLUGINHOST_OWN_MESSAGE_THREAD 0
+#endif
+
+//-----------------------------------------------------------------------------
+// MessageCommands
+// Preallocated queue of work for the message thread. Commands are stored in
+// fixed-size slots (no std::function or message object per call) and drained
+// in order by a single AsyncUpdater, so posting one costs an uncontended lock
+// and, if the message thread isn't already woken, one wakeup. Commands have to
+// fit a slot (checked at compile time), the slots are sized for the largest of
+// the host's commands (loading a plugin). When the queue
+// is full commands spill into an overflow list (which allocates) that the
+// message thread drains after the queue, so the caller, usually the VM thread,
+// never waits and the order is kept.
+//-----------------------------------------------------------------------------
+class MessageCommands : private juce::AsyncUpdater
+{
+public:
+
+    static constexpr size_t commandSize = 128;
+    static constexpr int capacity = 256;
+
+    using Command = juce::FixedSizeFunction<commandSize, void()>;
+
+    // true if a function object of type Fn can be stored in a slot
+    template <typename Fn>
+    static constexpr bool fitsSlot()
+    {
+        return sizeof(Fn) <= commandSize && alignof(Fn) <= alignof(std::max_align_t);
+    }
+
+    // run func on the message thread, right away if this is the message thread
+    template <typename Func>
+    static void call(Func&& func)
+    {
+        if (juce::MessageManager::existsAndIsCurrentThread())
+        {
+            func();
+            return;
+        }
+        getInstance().push(std::forward<Func>(func));
+    }
+
+    // run func on the message thread and wait for it to finish
+    template <typename Func>
+    static void callSync(Func&& func)
+    {
+        if (juce::MessageManager::existsAndIsCurrentThread())
+        {
+            func();
+            return;
+        }
+
+        juce::WaitableEvent finished;
+        getInstance().push([&func, &finished]
+        {
+            func();
+            finished.signal();
+        });
+        finished.wait();
+    }
+
+private:
+
+    MessageCommands() = default;
+
+    ~MessageCommands() override
+    {
+        cancelPendingUpdate();
+    }
+
+    static MessageCommands& getInstance()
+    {
+        static MessageCommands instance;
+        return instance;
+    }
+
+    template <typename Func>
+    void push(Func&& func)
+    {
+        static_assert(fitsSlot<std::decay_t<Func>>(), "command too big for a slot");
+
+        Command command(std::forward<Func>(func));
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // once anything has spilled over, the rest follows it until the message thread catches up
+            if (m_count < capacity && m_overflow.empty())
+            {
+                m_commands[(size_t)((m_head + m_count) % capacity)] = std::move(command);
+                m_count++;
+            }
+            else
+            {
+                m_overflow.push_back(std::move(command));
+            }
+        }
+        triggerAsyncUpdate();
+    }
+
+    // message thread, one command at a time so a command can queue more
+    void handleAsyncUpdate() override
+    {
+        for (;;)
+        {
+            Command command;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_count > 0)
+                {
+                    command = std::move(m_commands[(size_t)m_head]);
+                    m_commands[(size_t)m_head] = nullptr;
+                    m_head = (m_head + 1) % capacity;
+                    m_count--;
+                }
+                else if (!m_overflow.empty())
+                {
+                    command = std::move(m_overflow.front());
+                    m_overflow.pop_front();
+                }
+                else
+                {
+                    return;
+                }
+            }
+
+            // whatever the command captured is released here, on the message thread
+            command();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::array<Command, capacity> m_commands;
+    int m_head = 0;
+    int m_count = 0;
+    // commands queued while the ring is full, only ever allocates then
+    std::deque<Command> m_overflow;
+};
+
+//-----------------------------------------------------------------------------
+// MessageThread
+// A thread owned by the chugin that becomes JUCE's message thread and runs its
+// dispatch loop, which sleeps until a message or event arrives instead of being
+// pumped every millisecond from ChucK's main thread hook. Only compiled in with
+// PLUGINHOST_OWN_MESSAGE_THREAD. Started and stopped from the main thread hook.
+//-----------------------------------------------------------------------------
+#if PLUGINHOST_OWN_MESSAGE_THREAD
+class MessageThread
+{
+public:
+
+    // start the thread and wait until JUCE is initialised on it, does nothing if it's running already
+    static void start()
+    {
+        auto& thread = getThread();
+        if (thread)
+            return;
+
+        juce::WaitableEvent started;
+        thread = new std::thread([&started]
+        {
+            juce::Thread::setCurrentThreadName("PluginHost Message Thread");
+
+            juce::initialiseJuce_GUI();
+            juce::MessageManager::getInstance()->setCurrentThreadAsMessageThread();
+            started.signal();
+
+            // until stopDispatchLoop()
+            juce::MessageManager::getInstance()->runDispatchLoop();
+
+            juce::shutdownJuce_GUI();
+        });
+        started.wait();
+    }
+
+    static bool isRunning() { return getThread() != nullptr; }
+
+    // run what's left in the queue, end the dispatch loop and shut JUCE down
+    static void stop()
+    {
+        auto& thread = getThread();
+        if (!thread)
+            return;
+
+        // posted after everything already queued
+        juce::MessageManager::getInstance()->stopDispatchLoop();
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+
+private:
+
+    // left alone if ChucK never calls the quit hook, a joinable std::thread would terminate the process on exit
+    static std::thread*& getThread()
+    {
+        static std::thread* thread = nullptr;
+        return thread;
+    }
+};
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// MidiEventQueue
+// Fixed capacity single-producer single-consumer ring of short MIDI messages, each
+// stamped with an absolute ChucK time (in samples). For MIDI input the MIDI
+// functions push from the shred, the audio thread drains everything due in the
+// block it's about to render into the block's MidiBuffer at sample accurate offsets.
+// For MIDI output it's the other way round, the shred pops one message at a time.
+// No allocation after construction.
+//-----------------------------------------------------------------------------
+class MidiEventQueue
+{
+public:
+
+    // compact message, sysex is not supported (the MIDI functions only send up to 3 bytes)
+    struct Event
+    {
+        int64_t time = 0;
+        juce::uint8 data[3] = {};
+        juce::uint8 size = 0;
+    };
+
+    static constexpr size_t capacity = 1024;
+
+    // Queue a message sent at time (producer)
+    // Returns false (and drops the message) if the queue is full
+    bool push(int64_t time, const juce::uint8* data, int size)
+    {
+        const size_t write = m_writePos.load(std::memory_order_relaxed);
+        if (write - m_readPos.load(std::memory_order_acquire) >= capacity)
+            return false;
+
+        Event& event = m_events[write & (capacity - 1)];
+        event.time = time;
+        event.size = (juce::uint8)juce::jlimit(0, 3, size);
+        for (int i = 0; i < event.size; i++)
+            event.data[i] = data[i];
+
+        m_writePos.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Move every message sent before blockTime + numSamples into midi (consumer)
+    // Offsets are relative to blockTime, late messages land on the first sample.
+    void drainInto(juce::MidiBuffer& midi, int64_t blockTime, int numSamples)
+    {
+        const size_t write = m_writePos.load(std::memory_order_acquire);
+        size_t read = m_readPos.load(std::memory_order_relaxed);
+
+        for (; read != write; read++)
+        {
+            const Event& event = m_events[read & (capacity - 1)];
+            if (event.time >= blockTime + numSamples)
+                break;
+
+            const int offset = (int)std::max<int64_t>(0, event.time - blockTime);
+            midi.addEvent(event.data, event.size, offset);
+        }
+
+        m_readPos.store(read, std::memory_order_release);
+    }
+
+    // Take the oldest message (consumer), returns false if there is none
+    bool pop(Event& event)
+    {
+        const size_t read = m_readPos.load(std::memory_order_relaxed);
+        if (read == m_writePos.load(std::memory_order_acquire))
+            return false;
+
+        event = m_events[read & (capacity - 1)];
+        m_readPos.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    // drop all queued messages (consumer)
+    void clear()
+    {
+        m_readPos.store(m_writePos.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+
+    std::array<Event, capacity> m_events;
+    alignas(64) std::atomic<size_t> m_writePos { 0 };
+    alignas(64) std::atomic<size_t> m_readPos { 0 };
+};
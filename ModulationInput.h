@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+//-----------------------------------------------------------------------------
+// ModulationInput
+// Backs the PluginMod UGen, which a PluginHost can take its modulation inputs
+// from (see PluginHost::setModulationInput) instead of every host having extra
+// UGen inputs. Its tick keeps the latest frame of its inputs and the host reads
+// that frame on its own tick, so the signals are sampled once per ChucK tick,
+// give or take the one frame ChucK may tick the two in either order.
+// VM thread only, ticks run there too.
+//-----------------------------------------------------------------------------
+class ModulationInput
+{
+public:
+
+    static constexpr int numInputs = 8;
+
+    // keep the last of nframes frames of numInputs samples, the single output stays silent
+    void tick(const float* in, float* out, int nframes)
+    {
+        if (nframes > 0)
+            std::copy(in + (nframes - 1) * numInputs, in + nframes * numInputs, m_values.begin());
+        std::fill(out, out + nframes, 0.0f);
+    }
+
+    // one frame, numInputs samples
+    const float* getFrame() const { return m_values.data(); }
+
+private:
+
+    std::array<float, numInputs> m_values {};
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+
+//-----------------------------------------------------------------------------
+// OperationPool
+// Process-wide free list of fixed-size blocks for the small objects every host
+// operation creates (the AsyncOperation, its AsyncEventContext and coalesced
+// commands), so starting one from a shred doesn't go to the heap. Used through
+// Allocator with std::allocate_shared, which puts the object and its control
+// block in one block. Blocks are taken on the VM thread and given back on
+// whichever thread lets go of the last reference. Anything bigger than a block,
+// or asked for while the pool is empty, falls back to operator new.
+//-----------------------------------------------------------------------------
+class OperationPool
+{
+public:
+
+    static constexpr size_t blockSize = 256;
+    static constexpr size_t numBlocks = 1024;
+
+    static void* allocate(size_t size)
+    {
+        if (size <= blockSize)
+        {
+            auto& pool = getInstance();
+            std::lock_guard<std::mutex> lock(pool.m_mutex);
+            if (auto* block = pool.m_free)
+            {
+                pool.m_free = block->next;
+                return block;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    static void deallocate(void* pointer)
+    {
+        auto& pool = getInstance();
+        if (!pool.owns(pointer))
+        {
+            ::operator delete(pointer);
+            return;
+        }
+
+        auto* block = static_cast<Block*>(pointer);
+        std::lock_guard<std::mutex> lock(pool.m_mutex);
+        block->next = pool.m_free;
+        pool.m_free = block;
+    }
+
+    // for std::allocate_shared
+    template <typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+        template <typename U>
+        Allocator(const Allocator<U>&) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(OperationPool::allocate(n * sizeof(T))); }
+        void deallocate(T* pointer, size_t) { OperationPool::deallocate(pointer); }
+
+        template <typename U>
+        bool operator==(const Allocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const Allocator<U>&) const { return false; }
+    };
+
+private:
+
+    union Block
+    {
+        Block* next;
+        alignas(std::max_align_t) unsigned char storage[blockSize];
+    };
+
+    // the blocks are allocated once, with the first operation
+    OperationPool() : m_blocks(new Block[numBlocks])
+    {
+        for (size_t i = 0; i < numBlocks; i++)
+            m_blocks[i].next = i + 1 < numBlocks ? &m_blocks[i + 1] : nullptr;
+        m_free = &m_blocks[0];
+    }
+
+    // never destroyed, operations may still be let go of during static destruction
+    static OperationPool& getInstance()
+    {
+        static OperationPool* instance = new OperationPool();
+        return *instance;
+    }
+
+    bool owns(const void* pointer) const
+    {
+        auto* block = static_cast<const Block*>(pointer);
+        std::less<const Block*> less;
+        return !less(block, &m_blocks[0]) && less(block, &m_blocks[0] + numBlocks);
+    }
+
+    std::unique_ptr<Block[]> m_blocks;
+    std::mutex m_mutex;
+    Block* m_free = nullptr;
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+//-----------------------------------------------------------------------------
+// ParallelScheduler
+// Chugin-wide pool of realtime worker threads shared by every PluginHost that
+// opts into parallel processing. ChucK ticks the instances one after another,
+// each submits its block as a job and picks the result up on its next block,
+// so independent instances end up running concurrently on different cores.
+// Jobs go through bounded lock-free queues which any idle worker pulls from:
+// whole blocks of parallel hosts through the normal one, graph nodes the
+// audio thread is waiting on through the urgent one, which is served first.
+// This stands in for a work-stealing pool: jobs are coarse (a host's block or
+// a graph node) and only a handful are queued per tick, so shared queues that
+// every idle worker pulls from balance the load just as well, without
+// per-worker deques to steal from.
+//-----------------------------------------------------------------------------
+class ParallelScheduler
+{
+public:
+
+    // a unit of work, run on one of the workers
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void run() = 0;
+    };
+
+    static constexpr int maxWorkers = 64;
+
+    ~ParallelScheduler()
+    {
+        setNumWorkers(0);
+    }
+
+    // the process-wide scheduler, created on first use (message thread)
+    static std::shared_ptr<ParallelScheduler> getShared()
+    {
+        std::lock_guard<std::mutex> lock(getSharedMutex());
+        auto& weak = getSharedInstance();
+        auto scheduler = weak.lock();
+        if (!scheduler)
+        {
+            scheduler.reset(new ParallelScheduler());
+            weak = scheduler;
+        }
+        return scheduler;
+    }
+
+    // Worker count used by the shared scheduler (any thread), see applyDefaultNumWorkers()
+    static void setDefaultNumWorkers(int num)
+    {
+        defaultNumWorkers().store(juce::jlimit(1, maxWorkers, num));
+    }
+
+    static int getDefaultNumWorkers()
+    {
+        return defaultNumWorkers().load();
+    }
+
+    // Start / stop the shared scheduler's workers to match the default count, if it exists (message thread)
+    // Stopping a worker waits for its current job, so this must never run on the audio thread.
+    static void applyDefaultNumWorkers()
+    {
+        std::lock_guard<std::mutex> lock(getSharedMutex());
+        if (auto scheduler = getSharedInstance().lock())
+            scheduler->setNumWorkers(getDefaultNumWorkers());
+    }
+
+    // start / stop workers, a stopped worker finishes its current job first (message thread)
+    void setNumWorkers(int num)
+    {
+        num = juce::jlimit(0, maxWorkers, num);
+        m_numWorkers = num;
+
+        for (int i = 0; i < maxWorkers; i++)
+        {
+            auto& worker = *m_workers[(size_t)i];
+            if (i < num && !worker.isThreadRunning())
+            {
+                const auto options = juce::Thread::RealtimeOptions().withPriority(10);
+                if (!worker.startRealtimeThread(options))
+                    worker.startThread(juce::Thread::Priority::highest);
+            }
+            else if (i >= num && worker.isThreadRunning())
+            {
+                worker.signalThreadShouldExit();
+                worker.wake();
+                worker.stopThread(1000);
+            }
+        }
+    }
+
+    int getNumWorkers() const { return m_numWorkers.load(); }
+
+    // Queue a job and wake an idle worker (audio thread)
+    // Urgent jobs are ones the caller waits for, they are picked up ahead of the others.
+    // Returns false if the queue is full or there are no workers, the caller should run the job itself
+    bool submit(Job& job, bool urgent = false)
+    {
+        if (m_numWorkers.load() == 0 || !(urgent ? m_urgentQueue : m_queue).push(&job))
+            return false;
+
+        // if every worker is busy the job is picked up by whichever finishes first
+        for (int i = 0; i < m_numWorkers.load(); i++)
+        {
+            if (m_workers[(size_t)i]->tryWake())
+                break;
+        }
+        return true;
+    }
+
+    // Run one queued urgent job on the calling thread, false if there is none (audio thread)
+    // Lets a caller waiting for its urgent jobs work on them instead of waiting behind the workers.
+    bool runUrgentJob()
+    {
+        Job* job = m_urgentQueue.pop();
+        if (!job)
+            return false;
+        job->run();
+        return true;
+    }
+
+private:
+
+    ParallelScheduler()
+    {
+        for (auto& worker : m_workers)
+            worker = std::make_unique<Worker>(*this);
+        setNumWorkers(getDefaultNumWorkers());
+    }
+
+    //-------------------------------------------------------------------------
+    // bounded multi-producer multi-consumer queue (Vyukov), no allocation after construction
+    //-------------------------------------------------------------------------
+    class JobQueue
+    {
+    public:
+        JobQueue()
+        {
+            for (size_t i = 0; i < capacity; i++)
+                cells[i].sequence.store(i);
+        }
+
+        bool push(Job* job)
+        {
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = cells[pos & (capacity - 1)];
+                const auto diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.job = job;
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                    return false; // full
+                else
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        Job* pop()
+        {
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = cells[pos & (capacity - 1)];
+                const auto diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+                if (diff == 0)
+                {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        Job* job = cell.job;
+                        cell.sequence.store(pos + capacity, std::memory_order_release);
+                        return job;
+                    }
+                }
+                else if (diff < 0)
+                    return nullptr; // empty
+                else
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        static constexpr size_t capacity = 256;
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence { 0 };
+            Job* job = nullptr;
+        };
+
+        std::array<Cell, capacity> cells;
+        alignas(64) std::atomic<size_t> enqueuePos { 0 };
+        alignas(64) std::atomic<size_t> dequeuePos { 0 };
+    };
+
+    //-------------------------------------------------------------------------
+    // worker thread
+    //-------------------------------------------------------------------------
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(ParallelScheduler& owner) : juce::Thread("PluginHost Parallel Worker"), m_owner(owner) {}
+
+        // wake the worker if it's waiting for a job, returns false if it's busy
+        bool tryWake()
+        {
+            if (!m_idle.exchange(false))
+                return false;
+            m_wakeUp.signal();
+            return true;
+        }
+
+        void wake() { m_wakeUp.signal(); }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (Job* job = m_owner.popJob())
+                {
+                    job->run();
+                    continue;
+                }
+
+                // announce before the final check, so a job submitted in between either
+                // is seen here or finds this worker idle and wakes it
+                m_idle = true;
+                if (Job* job = m_owner.popJob())
+                {
+                    m_idle = false;
+                    job->run();
+                    continue;
+                }
+                m_wakeUp.wait(100);
+                m_idle = false;
+            }
+        }
+
+    private:
+        ParallelScheduler& m_owner;
+        std::atomic<bool> m_idle { false };
+        juce::WaitableEvent m_wakeUp;
+    };
+
+    // urgent jobs first
+    Job* popJob()
+    {
+        if (Job* job = m_urgentQueue.pop())
+            return job;
+        return m_queue.pop();
+    }
+
+    static std::mutex& getSharedMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::weak_ptr<ParallelScheduler>& getSharedInstance()
+    {
+        static std::weak_ptr<ParallelScheduler> instance;
+        return instance;
+    }
+
+    static std::atomic<int>& defaultNumWorkers()
+    {
+        // leave a core for the ChucK audio thread
+        static std::atomic<int> numWorkers { juce::jlimit(1, maxWorkers, juce::SystemStats::getNumCpus() - 1) };
+        return numWorkers;
+    }
+
+    JobQueue m_queue;
+    JobQueue m_urgentQueue;
+    // preallocated so submit() can walk them while workers are started / stopped
+    std::array<std::unique_ptr<Worker>, maxWorkers> m_workers;
+    std::atomic<int> m_numWorkers { 0 };
+};
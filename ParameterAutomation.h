@@ -0,0 +1,219 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ParameterQueue.h"
+#include "PluginChain.h"
+
+#include <array>
+#include <cmath>
+
+//-----------------------------------------------------------------------------
+// ParameterAutomation
+// Ramps and LFOs running on plugin parameters, evaluated by the audio thread at
+// the start of every (sub-)block instead of a shred waking up to set each step.
+// At most one ramp or LFO runs per parameter, a new one (or a plain set) replaces it.
+// A ramp can be a list of segments, each following on from the one before, which
+// are queued together and walked through here. Fixed number of slots, no
+// allocation. Audio thread only.
+//-----------------------------------------------------------------------------
+class ParameterAutomation
+{
+public:
+
+    enum Shape { sine, triangle, saw, square };
+
+    static constexpr int maxModulators = 64;
+    static constexpr int maxSegments = 32;
+
+    // Start, replace or stop the ramp / LFO a change describes
+    // currentValue is the parameter's value when a ramp starts
+    void apply(const ParameterQueue::Change& change, float currentValue)
+    {
+        if (change.type == ParameterQueue::Change::stop || change.type == ParameterQueue::Change::set)
+        {
+            for (auto& modulator : m_modulators)
+            {
+                if (modulator.active && modulator.plugin == change.plugin && (change.index < 0 || modulator.index == change.index))
+                    modulator.active = false;
+            }
+            return;
+        }
+
+        // a segment follows the parameter's current ramp (segments past maxSegments are dropped)
+        const bool ramp = change.type != ParameterQueue::Change::lfo;
+        if (change.append && ramp)
+        {
+            for (auto& modulator : m_modulators)
+            {
+                if (modulator.active && modulator.plugin == change.plugin && modulator.index == change.index
+                    && modulator.type != ParameterQueue::Change::lfo)
+                {
+                    if (modulator.numSegments < maxSegments)
+                        modulator.segments[(size_t)modulator.numSegments++] = { change.type, change.value, change.length };
+                    return;
+                }
+            }
+        }
+
+        // reuse the parameter's slot, or take a free one (if all are taken the change is dropped)
+        Modulator* slot = nullptr;
+        for (auto& modulator : m_modulators)
+        {
+            if (modulator.active && modulator.plugin == change.plugin && modulator.index == change.index)
+            {
+                slot = &modulator;
+                break;
+            }
+            if (!modulator.active && !slot)
+                slot = &modulator;
+        }
+        if (!slot)
+            return;
+
+        slot->active = true;
+        slot->plugin = change.plugin;
+        slot->index = change.index;
+        slot->type = ramp ? ParameterQueue::Change::linear : ParameterQueue::Change::lfo;
+        slot->startTime = (double)change.time;
+        slot->startValue = currentValue;
+        slot->value = change.value;
+        slot->frequency = change.frequency;
+        slot->depth = change.depth;
+        slot->shape = change.shape;
+        slot->segments[0] = { change.type, change.value, change.length };
+        slot->numSegments = 1;
+        slot->current = 0;
+    }
+
+    bool isActive() const
+    {
+        for (auto& modulator : m_modulators)
+        {
+            if (modulator.active)
+                return true;
+        }
+        return false;
+    }
+
+    // Set every modulated parameter of the given plugins to its value at time
+    // Finished ramps end exactly on their target, modulators of plugins that are gone are dropped.
+    void process(const PluginList& plugins, int64_t time)
+    {
+        for (auto& modulator : m_modulators)
+        {
+            if (!modulator.active)
+                continue;
+
+            juce::AudioProcessorParameter* param = nullptr;
+            for (auto& plugin : plugins)
+            {
+                if (plugin.get() != modulator.plugin)
+                    continue;
+                auto& params = plugin->getParameters();
+                if (modulator.index < params.size())
+                    param = params[modulator.index];
+                break;
+            }
+
+            if (!param)
+            {
+                modulator.active = false;
+                continue;
+            }
+
+            const bool running = modulator.advance(time);
+            param->setValue(modulator.getValue(time));
+            if (!running)
+                modulator.active = false;
+        }
+    }
+
+private:
+
+    struct Segment
+    {
+        ParameterQueue::Change::Type type = ParameterQueue::Change::linear;
+        float target = 0.0f;
+        // in samples
+        double length = 0.0;
+    };
+
+    struct Modulator
+    {
+        // Move on to the ramp segment running at time, false once the last one has finished
+        // (always true for an LFO)
+        bool advance(int64_t time)
+        {
+            if (type == ParameterQueue::Change::lfo)
+                return true;
+
+            while ((double)time - startTime >= segments[(size_t)current].length)
+            {
+                if (current + 1 >= numSegments)
+                    return false;
+
+                // the next segment starts where this one ends
+                startTime += segments[(size_t)current].length;
+                startValue = segments[(size_t)current].target;
+                current++;
+            }
+            return true;
+        }
+
+        float getValue(int64_t time) const
+        {
+            const double elapsed = (double)time - startTime;
+            if (type == ParameterQueue::Change::lfo)
+            {
+                double phase = elapsed * frequency;
+                phase -= std::floor(phase);
+                return juce::jlimit(0.0f, 1.0f, value + depth * getWave(phase));
+            }
+
+            const auto& segment = segments[(size_t)current];
+            const double position = segment.length > 0.0 ? juce::jlimit(0.0, 1.0, elapsed / segment.length) : 1.0;
+            if (segment.type == ParameterQueue::Change::exponential)
+            {
+                // offset so that ramps from / to 0 still work
+                constexpr double offset = 0.001;
+                const double ratio = ((double)segment.target + offset) / ((double)startValue + offset);
+                return (float)(((double)startValue + offset) * std::pow(ratio, position) - offset);
+            }
+            return (float)(startValue + (segment.target - startValue) * position);
+        }
+
+        // -1 to 1
+        float getWave(double phase) const
+        {
+            switch (shape)
+            {
+                case triangle: return (float)(1.0 - 4.0 * std::abs(phase - 0.5));
+                case saw:      return (float)(2.0 * phase - 1.0);
+                case square:   return phase < 0.5 ? 1.0f : -1.0f;
+                default:       return (float)std::sin(juce::MathConstants<double>::twoPi * phase);
+            }
+        }
+
+        bool active = false;
+        const juce::AudioProcessor* plugin = nullptr;
+        int index = 0;
+        // lfo, or linear for a ramp (each segment has its own curve)
+        ParameterQueue::Change::Type type = ParameterQueue::Change::linear;
+        // start of the current segment / of the LFO, in samples
+        double startTime = 0.0;
+        // value at the start of the current segment
+        float startValue = 0.0f;
+        // LFO center, frequency in cycles per sample, depth and shape
+        float value = 0.0f;
+        double frequency = 0.0;
+        float depth = 0.0f;
+        int shape = sine;
+        // ramp segments, current is the one running
+        std::array<Segment, maxSegments> segments;
+        int numSegments = 0;
+        int current = 0;
+    };
+
+    std::array<Modulator, maxModulators> m_modulators;
+};
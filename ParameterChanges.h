@@ -0,0 +1,227 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// ParameterChanges
+// Collects the parameter changes a plugin reports itself (edits in its editor,
+// automation it generates, preset loads) so shreds can pick up what changed instead
+// of polling every parameter. Registered as a listener of its plugin, which may
+// report from any thread, so changes go through per-parameter dirty flags and a
+// lock-free ring of indices. A parameter sits in the ring at most once however
+// often it changes before it is drained, so the ring (sized to the parameter count)
+// never overflows, and a drained change always carries the latest value.
+// Changes the host makes itself (param(), ramps, modulation) aren't reported.
+// Also caches the parameters' display text for the shreds. The listener the
+// plugin calls is a separately owned Sink, which is kept after the
+// ParameterChanges is destroyed for as long as its plugin is alive.
+//-----------------------------------------------------------------------------
+class ParameterChanges
+{
+public:
+
+    // listen to plugin, notify is set whenever a change is queued (message thread)
+    ParameterChanges(std::shared_ptr<juce::AudioPluginInstance> plugin, std::shared_ptr<std::atomic<bool>> notify)
+        : m_plugin(plugin), m_sink(std::make_shared<Sink>(plugin->getParameters().size(), std::move(notify)))
+    {
+        m_display.resize((size_t)m_sink->numParams);
+        plugin->addListener(m_sink.get());
+    }
+
+    ~ParameterChanges()
+    {
+        // The plugin only holds its listener lock while fetching a listener, not while calling it, so a
+        // callback may still be running after removal. The sink is kept until the plugin is gone.
+        if (auto plugin = m_plugin.lock())
+        {
+            plugin->removeListener(m_sink.get());
+            retire(m_plugin, std::move(m_sink));
+        }
+    }
+
+    ParameterChanges(const ParameterChanges&) = delete;
+    ParameterChanges& operator=(const ParameterChanges&) = delete;
+
+    int size() const { return m_sink->numParams; }
+
+    // Take the oldest changed parameter and its latest value (single consumer, the shreds)
+    bool pop(int& index, float& value)
+    {
+        auto& sink = *m_sink;
+        const size_t read = m_readPos.load(std::memory_order_relaxed);
+        Cell& cell = sink.cells[read & sink.mask];
+        if (cell.sequence.load(std::memory_order_acquire) != read + 1)
+            return false;
+
+        index = cell.index;
+        cell.sequence.store(read + sink.mask + 1, std::memory_order_release);
+        m_readPos.store(read + 1, std::memory_order_relaxed);
+
+        // clear before reading the value, a change landing in between queues the parameter again
+        sink.dirty[(size_t)index].store(false, std::memory_order_seq_cst);
+        value = sink.values[(size_t)index].load(std::memory_order_relaxed);
+        return true;
+    }
+
+    // drop everything queued so far (consumer)
+    void clear()
+    {
+        int index;
+        float value;
+        while (pop(index, value)) {}
+    }
+
+    // Display text of a parameter, only asked from the plugin again once its value changed (consumer)
+    const std::string& getDisplay(const juce::AudioProcessorParameter& param, int index)
+    {
+        auto& entry = m_display[(size_t)index];
+        const float value = param.getValue();
+        if (!entry.valid || entry.value != value)
+        {
+            entry.text = param.getCurrentValueAsText().toStdString();
+            entry.value = value;
+            entry.valid = true;
+        }
+        return entry.text;
+    }
+
+    // let go of the sinks whose plugins have been deleted (message thread, regularly from the host's ConfigReclaimer)
+    static void reclaimRetired()
+    {
+        auto& retired = getRetired();
+        std::lock_guard<std::mutex> lock(retired.mutex);
+        auto& sinks = retired.sinks;
+        sinks.erase(std::remove_if(sinks.begin(), sinks.end(), [](const RetiredSink& entry) { return entry.plugin.expired(); }),
+                    sinks.end());
+    }
+
+private:
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        int index = 0;
+    };
+
+    // What the plugin calls into, owned separately so it can outlive the ParameterChanges
+    struct Sink : public juce::AudioProcessorListener
+    {
+        Sink(int numParameters, std::shared_ptr<std::atomic<bool>> notifyFlag)
+            : notify(std::move(notifyFlag)), numParams(numParameters)
+        {
+            values = std::make_unique<std::atomic<float>[]>((size_t)numParams);
+            dirty = std::make_unique<std::atomic<bool>[]>((size_t)numParams);
+            for (int i = 0; i < numParams; i++)
+            {
+                values[(size_t)i] = 0.0f;
+                dirty[(size_t)i] = false;
+            }
+
+            const size_t capacity = (size_t)juce::nextPowerOfTwo(juce::jmax(1, numParams));
+            cells = std::make_unique<Cell[]>(capacity);
+            for (size_t i = 0; i < capacity; i++)
+                cells[i].sequence = i;
+            mask = capacity - 1;
+        }
+
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int index, float value) override
+        {
+            if (index < 0 || index >= numParams)
+                return;
+
+            values[(size_t)index].store(value, std::memory_order_relaxed);
+            if (dirty[(size_t)index].exchange(true, std::memory_order_seq_cst))
+                return;
+
+            push(index);
+            notify->store(true, std::memory_order_release);
+        }
+
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override {}
+
+        // bounded multi-producer ring (plugins report from their UI and audio threads alike)
+        void push(int index)
+        {
+            size_t write = writePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = cells[write & mask];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                if (sequence == write)
+                {
+                    if (writePos.compare_exchange_weak(write, write + 1, std::memory_order_relaxed))
+                    {
+                        cell.index = index;
+                        cell.sequence.store(write + 1, std::memory_order_release);
+                        return;
+                    }
+                }
+                else if (sequence < write)
+                {
+                    // can't happen as a parameter is queued at most once, but never spin on a full ring
+                    dirty[(size_t)index].store(false);
+                    return;
+                }
+                else
+                {
+                    write = writePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // shared with the host, which may be gone before the plugin
+        std::shared_ptr<std::atomic<bool>> notify;
+        const int numParams;
+        // latest reported value and queued flag of each parameter
+        std::unique_ptr<std::atomic<float>[]> values;
+        std::unique_ptr<std::atomic<bool>[]> dirty;
+        std::unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> writePos { 0 };
+    };
+
+    // sinks of destroyed ParameterChanges whose plugins may still be alive
+    struct RetiredSink
+    {
+        std::weak_ptr<juce::AudioPluginInstance> plugin;
+        std::shared_ptr<Sink> sink;
+    };
+
+    struct Retired
+    {
+        std::mutex mutex;
+        std::vector<RetiredSink> sinks;
+    };
+
+    static Retired& getRetired()
+    {
+        static Retired retired;
+        return retired;
+    }
+
+    static void retire(std::weak_ptr<juce::AudioPluginInstance> plugin, std::shared_ptr<Sink> sink)
+    {
+        auto& retired = getRetired();
+        std::lock_guard<std::mutex> lock(retired.mutex);
+        retired.sinks.push_back({ std::move(plugin), std::move(sink) });
+    }
+
+    std::weak_ptr<juce::AudioPluginInstance> m_plugin;
+    std::shared_ptr<Sink> m_sink;
+    // display text cache (consumer)
+    struct Display
+    {
+        float value = 0.0f;
+        bool valid = false;
+        std::string text;
+    };
+    std::vector<Display> m_display;
+    alignas(64) std::atomic<size_t> m_readPos { 0 };
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+// ParameterQueue
+// Fixed capacity single-producer single-consumer ring of parameter changes, each
+// stamped with the absolute ChucK time (in samples) it was made at. A change either
+// sets a value or starts / stops a ramp or LFO (see ParameterAutomation). Shreds push,
+// the audio thread pops the changes as it reaches their sample, splitting the
+// block there if needed. Changes are stamped with the time they are made at, never
+// a later one, as everything behind them would wait. No allocation after construction.
+//-----------------------------------------------------------------------------
+class ParameterQueue
+{
+public:
+
+    struct Change
+    {
+        enum Type : uint8_t
+        {
+            set,          // jump to value (stops any ramp / LFO on the parameter)
+            linear,       // ramp from the current value to value over length samples
+            exponential,  // same, along an exponential curve
+            lfo,          // oscillate around value by depth at frequency
+            stop          // stop any ramp / LFO on the parameter, or on all of the plugin's with index -1
+        };
+
+        int64_t time = 0;
+        // only compared against the plugins of the current config, never dereferenced
+        // on its own, so a plugin removed in the meantime is simply skipped
+        const juce::AudioProcessor* plugin = nullptr;
+        int index = 0;
+        float value = 0.0f;
+        Type type = set;
+        // ramps: length in samples, and whether to follow the parameter's current ramp instead of replacing it
+        double length = 0.0;
+        bool append = false;
+        // LFOs: frequency in cycles per sample
+        double frequency = 0.0;
+        float depth = 0.0f;
+        int shape = 0;
+    };
+
+    static constexpr size_t capacity = 1024;
+
+    // Queue a change (producer), returns false if the queue is full
+    bool push(const Change& change)
+    {
+        const size_t write = m_writePos.load(std::memory_order_relaxed);
+        if (write - m_readPos.load(std::memory_order_acquire) >= capacity)
+            return false;
+
+        m_changes[write & (capacity - 1)] = change;
+        m_writePos.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Time of the oldest queued change (consumer), returns false if there is none
+    bool getNextTime(int64_t& time) const
+    {
+        const size_t read = m_readPos.load(std::memory_order_relaxed);
+        if (read == m_writePos.load(std::memory_order_acquire))
+            return false;
+
+        time = m_changes[read & (capacity - 1)].time;
+        return true;
+    }
+
+    // true if no change is waiting (either side)
+    bool empty() const
+    {
+        return m_readPos.load(std::memory_order_acquire) == m_writePos.load(std::memory_order_acquire);
+    }
+
+    // Take the oldest change if it was made before time (consumer)
+    bool popBefore(int64_t time, Change& change)
+    {
+        const size_t read = m_readPos.load(std::memory_order_relaxed);
+        if (read == m_writePos.load(std::memory_order_acquire))
+            return false;
+
+        const Change& next = m_changes[read & (capacity - 1)];
+        if (next.time >= time)
+            return false;
+
+        change = next;
+        m_readPos.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+
+    std::array<Change, capacity> m_changes;
+    alignas(64) std::atomic<size_t> m_writePos { 0 };
+    alignas(64) std::atomic<size_t> m_readPos { 0 };
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// ParameterTable
+// Parameter metadata of one plugin, read once when the plugin is installed (and
+// again when it reports a parameter layout change) so that lookups don't walk the
+// parameter list and convert JUCE Strings every time. Plugins like VST3 instruments
+// can expose thousands of "MIDI CC" proxy parameters, the table keeps a separate
+// list of the real ones. Immutable once built.
+//-----------------------------------------------------------------------------
+class ParameterTable
+{
+public:
+
+    struct Info
+    {
+        std::string name;
+        std::string label;
+        // stable ID from the plugin format, empty if it has none
+        std::string id;
+        float defaultValue = 0.0f;
+        // number of steps, or 0 for a continuous parameter
+        int numSteps = 0;
+        // VST3 MIDI CC proxy parameter
+        bool midiProxy = false;
+    };
+
+    // read the metadata of all parameters (message thread)
+    explicit ParameterTable(const juce::AudioProcessor& processor)
+    {
+        auto& params = processor.getParameters();
+        m_params.reserve((size_t)params.size());
+
+        for (int i = 0; i < params.size(); ++i)
+        {
+            auto* param = params[i];
+            Info info;
+            const auto name = param->getName(128);
+            info.name = name.toStdString();
+            info.label = param->getLabel().toStdString();
+            if (auto* hosted = dynamic_cast<juce::HostedAudioProcessorParameter*>(param))
+                info.id = hosted->getParameterID().toStdString();
+            info.defaultValue = param->getDefaultValue();
+            info.numSteps = param->isDiscrete() ? param->getNumSteps() : 0;
+            info.midiProxy = name.startsWith("MIDI CC");
+
+            // duplicate names / IDs resolve to the first parameter, like a linear search would
+            m_byName.emplace(info.name, i);
+            if (!info.id.empty())
+                m_byId.emplace(info.id, i);
+            if (!info.midiProxy)
+                m_nonMidiParams.push_back(i);
+
+            m_params.push_back(std::move(info));
+        }
+    }
+
+    int size() const { return (int)m_params.size(); }
+
+    // metadata of a parameter, null if out of range
+    const Info* get(int index) const
+    {
+        return index >= 0 && index < size() ? &m_params[(size_t)index] : nullptr;
+    }
+
+    // parameter index by name / ID, -1 if there is none
+    int findByName(const std::string& name) const
+    {
+        auto it = m_byName.find(name);
+        return it != m_byName.end() ? it->second : -1;
+    }
+
+    int findById(const std::string& id) const
+    {
+        auto it = m_byId.find(id);
+        return it != m_byId.end() ? it->second : -1;
+    }
+
+    // the parameters which aren't MIDI CC proxies, as indices into the full list
+    const std::vector<int>& getNonMidiParams() const { return m_nonMidiParams; }
+
+private:
+
+    std::vector<Info> m_params;
+    std::unordered_map<std::string, int> m_byName;
+    std::unordered_map<std::string, int> m_byId;
+    std::vector<int> m_nonMidiParams;
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// PluginCatalog
+// Chugin-wide plugin format manager and list of known plugins, shared by every
+// PluginHost instead of each one setting up its own. Scan results are kept in an
+// XML cache on disk keyed by the plugin file's path, size and modification time,
+// so loading a plugin that was seen before (in this or an earlier session)
+// doesn't open and probe its binary again. Files that crashed or hung the
+// out-of-process scanner (see PluginScanner) are blacklisted in the same cache.
+// Message thread only, apart from getShared() and search().
+//-----------------------------------------------------------------------------
+class PluginCatalog
+{
+public:
+
+    // the process-wide catalog, created on first use
+    static std::shared_ptr<PluginCatalog> getShared()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<PluginCatalog> instance;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto catalog = instance.lock();
+        if (!catalog)
+        {
+            catalog.reset(new PluginCatalog());
+            instance = catalog;
+        }
+        return catalog;
+    }
+
+    juce::AudioPluginFormatManager& getFormatManager() { return m_formatManager; }
+    juce::KnownPluginList& getKnownPlugins() { return m_knownPlugins; }
+
+    // Descriptions of the plugins in a file, from the cache if the file is unchanged since it was
+    // last scanned, otherwise scanned (and cached). Returns false if no format handles the file.
+    bool findPlugins(const juce::File& file, juce::OwnedArray<juce::PluginDescription>& descriptions)
+    {
+        const auto path = file.getFullPathName();
+        if (isBlacklisted(path))
+            std::cout << "PluginHost: " << file.getFileName() << " failed a previous scan, it may crash" << std::endl;
+
+        auto it = m_cache.find(path.toStdString());
+        if (it != m_cache.end() && isUpToDate(it->second, file))
+        {
+            for (auto& description : it->second.descriptions)
+                descriptions.add(new juce::PluginDescription(description));
+            return true;
+        }
+
+        juce::AudioPluginFormat* format = nullptr;
+        for (auto* f : m_formatManager.getFormats())
+        {
+            if (f->fileMightContainThisPluginType(path))
+            {
+                format = f;
+                break;
+            }
+        }
+        if (!format)
+            return false;
+
+        m_knownPlugins.scanAndAddFile(path, false, descriptions, *format);
+        addScanResult(file, descriptions);
+        save();
+        return true;
+    }
+
+    // true if the file was scanned since it last changed
+    bool isUpToDate(const juce::File& file) const
+    {
+        auto it = m_cache.find(file.getFullPathName().toStdString());
+        return it != m_cache.end() && isUpToDate(it->second, file);
+    }
+
+    // Record what a scan found in a file (a file without plugins is recorded too,
+    // so it isn't probed on every attempt), call save() when done adding
+    void addScanResult(const juce::File& file, const juce::OwnedArray<juce::PluginDescription>& descriptions)
+    {
+        const auto stamp = getStamp(file);
+        Entry entry { stamp.size, stamp.modified, {} };
+        for (auto* description : descriptions)
+        {
+            m_knownPlugins.addType(*description);
+            entry.descriptions.push_back(*description);
+        }
+        m_cache[file.getFullPathName().toStdString()] = std::move(entry);
+        m_blacklist.erase(file.getFullPathName().toStdString());
+    }
+
+    bool isBlacklisted(const juce::String& path) const { return m_blacklist.count(path.toStdString()) > 0; }
+    void addToBlacklist(const juce::String& path) { m_blacklist.insert(path.toStdString()); }
+
+    // Known plugins whose name, vendor, category or format contains query (ignoring case), sorted by name
+    // Safe from any thread, KnownPluginList locks itself.
+    std::vector<juce::PluginDescription> search(const juce::String& query) const
+    {
+        std::vector<juce::PluginDescription> results;
+        for (auto& type : m_knownPlugins.getTypes())
+        {
+            if (query.isEmpty() || type.name.containsIgnoreCase(query) || type.manufacturerName.containsIgnoreCase(query)
+                || type.category.containsIgnoreCase(query) || type.pluginFormatName.containsIgnoreCase(query))
+                results.push_back(type);
+        }
+        std::sort(results.begin(), results.end(), [](auto& a, auto& b) { return a.name.compareIgnoreCase(b.name) < 0; });
+        return results;
+    }
+
+    // forget all scan results and the blacklist, the next load of every plugin scans it again
+    void clear()
+    {
+        m_cache.clear();
+        m_blacklist.clear();
+        m_knownPlugins.clear();
+        m_cacheFile.deleteFile();
+    }
+
+    void save() const
+    {
+        juce::XmlElement xml("PLUGINCACHE");
+        for (auto& [path, entry] : m_cache)
+        {
+            auto* fileXml = xml.createNewChildElement("FILE");
+            fileXml->setAttribute("path", juce::String(path));
+            fileXml->setAttribute("size", juce::String(entry.size));
+            fileXml->setAttribute("modified", juce::String(entry.modified));
+            for (auto& description : entry.descriptions)
+                fileXml->addChildElement(description.createXml().release());
+        }
+        for (auto& path : m_blacklist)
+            xml.createNewChildElement("BLACKLISTED")->setAttribute("path", juce::String(path));
+
+        // not being able to write the cache only costs a rescan next session
+        if (!m_cacheFile.getParentDirectory().createDirectory() || !xml.writeTo(m_cacheFile))
+            std::cout << "PluginHost: Could not write plugin cache " << m_cacheFile.getFullPathName() << std::endl;
+    }
+
+    const juce::File& getCacheFile() const { return m_cacheFile; }
+
+private:
+
+    PluginCatalog()
+        : m_cacheFile(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                          .getChildFile("ChucK").getChildFile("PluginHost").getChildFile("PluginCache.xml"))
+    {
+        m_formatManager.addDefaultFormats();
+        load();
+    }
+
+    struct Stamp
+    {
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+    };
+
+    // plugin bundles (VST3 on macOS / Linux, AU) are directories, their stamp is that of the directory itself
+    static Stamp getStamp(const juce::File& file)
+    {
+        return { file.getSize(), file.getLastModificationTime().toMilliseconds() };
+    }
+
+    struct Entry
+    {
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+        std::vector<juce::PluginDescription> descriptions;
+    };
+
+    static bool isUpToDate(const Entry& entry, const juce::File& file)
+    {
+        const auto stamp = getStamp(file);
+        return entry.size == stamp.size && entry.modified == stamp.modified;
+    }
+
+    void load()
+    {
+        auto xml = juce::XmlDocument::parse(m_cacheFile);
+        if (!xml || !xml->hasTagName("PLUGINCACHE"))
+            return;
+
+        for (auto* fileXml : xml->getChildWithTagNameIterator("FILE"))
+        {
+            Entry entry;
+            entry.size = fileXml->getStringAttribute("size").getLargeIntValue();
+            entry.modified = fileXml->getStringAttribute("modified").getLargeIntValue();
+            for (auto* pluginXml : fileXml->getChildIterator())
+            {
+                juce::PluginDescription description;
+                if (description.loadFromXml(*pluginXml))
+                {
+                    m_knownPlugins.addType(description);
+                    entry.descriptions.push_back(description);
+                }
+            }
+            m_cache[fileXml->getStringAttribute("path").toStdString()] = std::move(entry);
+        }
+
+        for (auto* blacklistedXml : xml->getChildWithTagNameIterator("BLACKLISTED"))
+            m_blacklist.insert(blacklistedXml->getStringAttribute("path").toStdString());
+    }
+
+    juce::AudioPluginFormatManager m_formatManager;
+    juce::KnownPluginList m_knownPlugins;
+    juce::File m_cacheFile;
+    // scan results by file path
+    std::map<std::string, Entry> m_cache;
+    // files which crashed or hung the scanner
+    std::set<std::string> m_blacklist;
+};
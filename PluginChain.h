@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// PluginChain
+// An ordered list of plugins which are processed back to back, in place, on one
+// planar buffer. The MIDI buffer is handed along as well, so each stage receives
+// the MIDI output of the stage before it.
+//-----------------------------------------------------------------------------
+using PluginList = std::vector<std::shared_ptr<juce::AudioPluginInstance>>;
+
+// Run the chain on buffer/midi (audio thread). Each stage only sees the channels it uses,
+// channels it doesn't use are passed on untouched. Bypassed (suspended) stages are skipped.
+inline void processPluginChain(const PluginList& plugins, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    for (auto& plugin : plugins)
+    {
+        if (plugin->isSuspended())
+            continue;
+
+        const int numChannels = std::min(buffer.getNumChannels(),
+            std::max(plugin->getTotalNumInputChannels(), plugin->getTotalNumOutputChannels()));
+
+        // refer to the stage's channels without allocating
+        juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, buffer.getNumSamples());
+        plugin->processBlock(block, midi);
+    }
+}
@@ -91,7 +91,7 @@ void PluginEditorWindow::menuItemSelected(int menuID, int /*topLevelMenuIndex*/)
             {
                 auto file = chooser.getResult();
                 if (file != juce::File{})
-                    host.saveState(file.getFullPathName().toStdString());
+                    host.saveState(file.getFullPathName().toStdString(), host.findStage(editor->getAudioProcessor()));
             });
             break;
         }
@@ -103,7 +103,7 @@ void PluginEditorWindow::menuItemSelected(int menuID, int /*topLevelMenuIndex*/)
             {
                 auto file = chooser.getResult();
                 if (file != juce::File{})
-                    host.loadState(file.getFullPathName().toStdString());
+                    host.loadState(file.getFullPathName().toStdString(), host.findStage(editor->getAudioProcessor()));
             });
             break;
         }
@@ -0,0 +1,282 @@
+//-----------------------------------------------------------------------------
+// PluginGraph.cpp
+//-----------------------------------------------------------------------------
+
+#include "PluginGraph.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+//-----------------------------------------------------------------------------
+// compilation
+//-----------------------------------------------------------------------------
+PluginGraph::PluginGraph(const PluginList& plugins, const std::vector<Connection>& connections, int maxBlockSize,
+                         std::shared_ptr<ParallelScheduler> scheduler)
+    : m_scheduler(std::move(scheduler))
+{
+    const int numNodes = (int)plugins.size();
+    int numIOChannels = 0;
+
+    for (auto& plugin : plugins)
+    {
+        auto node = std::make_unique<Node>();
+        node->graph = this;
+        node->index = (int)m_nodes.size();
+        node->plugin = plugin;
+
+        const int numChannels = std::max(plugin->getTotalNumInputChannels(), plugin->getTotalNumOutputChannels());
+        node->buffer.setSize(numChannels, maxBlockSize);
+        node->buffer.clear();
+        // enough for dense MIDI, addEvents won't have to allocate on the audio thread
+        node->midi.ensureSize(4096);
+
+        numIOChannels = std::max(numIOChannels, numChannels);
+        m_nodes.push_back(std::move(node));
+    }
+
+    m_numIOChannels = numIOChannels;
+    m_outputBuffer.setSize(numIOChannels, maxBlockSize);
+    m_outputMidi.ensureSize(4096);
+
+    // wire up the connections, anything pointing at a node that doesn't exist is ignored
+    const auto isValidSource = [numNodes](int n) { return n == inputNode || (n >= 0 && n < numNodes); };
+    const auto isValidDestination = [numNodes](int n) { return n == outputNode || (n >= 0 && n < numNodes); };
+    for (auto& connection : connections)
+    {
+        if (!isValidSource(connection.source) || !isValidDestination(connection.destination))
+            continue;
+
+        auto& audioInputs = connection.destination == outputNode ? m_audioOutputs : m_nodes[(size_t)connection.destination]->audioInputs;
+        auto& midiInputs = connection.destination == outputNode ? m_midiOutputs : m_nodes[(size_t)connection.destination]->midiInputs;
+        if (connection.midi)
+            midiInputs.push_back(connection.source);
+        else
+        {
+            audioInputs.emplace_back();
+            audioInputs.back().source = connection.source;
+        }
+    }
+
+    // only nodes which (eventually) feed the output are worth running
+    std::vector<bool> used((size_t)numNodes, false);
+    std::vector<int> stack;
+    for (auto& input : m_audioOutputs) stack.push_back(input.source);
+    for (int source : m_midiOutputs) stack.push_back(source);
+    while (!stack.empty())
+    {
+        const int n = stack.back();
+        stack.pop_back();
+        if (n == inputNode || used[(size_t)n])
+            continue;
+        used[(size_t)n] = true;
+        for (auto& input : m_nodes[(size_t)n]->audioInputs) stack.push_back(input.source);
+        for (int source : m_nodes[(size_t)n]->midiInputs) stack.push_back(source);
+    }
+
+    // level = length of the longest path from the graph input
+    // (connect() refuses feedback loops, a node found on a loop anyway is treated as a leaf)
+    enum { unvisited = -1, visiting = -2 };
+    std::vector<int> levels((size_t)numNodes, unvisited);
+    std::function<int(int)> levelOf = [&](int n) -> int
+    {
+        if (n == inputNode) return -1;
+        int& level = levels[(size_t)n];
+        if (level == visiting) return -1;
+        if (level != unvisited) return level;
+
+        level = visiting;
+        int deepest = -1;
+        for (auto& input : m_nodes[(size_t)n]->audioInputs) deepest = std::max(deepest, levelOf(input.source));
+        for (int source : m_nodes[(size_t)n]->midiInputs) deepest = std::max(deepest, levelOf(source));
+        level = deepest + 1;
+        return level;
+    };
+
+    for (int n = 0; n < numNodes; n++)
+    {
+        if (!used[(size_t)n])
+            continue;
+        const int level = levelOf(n);
+        if ((int)m_levels.size() <= level)
+            m_levels.resize((size_t)level + 1);
+        m_levels[(size_t)level].push_back(m_nodes[(size_t)n].get());
+    }
+
+    // delay compensation: a node's audio inputs are delayed to the latest arriving one
+    // (MIDI connections aren't delayed, they don't take part in the alignment)
+    std::vector<int> outputTimes((size_t)numNodes, 0);
+    const auto timeOf = [&outputTimes](int source) { return source == inputNode ? 0 : outputTimes[(size_t)source]; };
+    const auto alignInputs = [&](std::vector<AudioInput>& inputs) -> int
+    {
+        int arrival = 0;
+        for (auto& input : inputs)
+            arrival = std::max(arrival, timeOf(input.source));
+        for (auto& input : inputs)
+            setDelay(input, arrival - timeOf(input.source), maxBlockSize);
+        return arrival;
+    };
+
+    for (auto& level : m_levels)
+    {
+        for (auto* node : level)
+        {
+            outputTimes[(size_t)node->index] = alignInputs(node->audioInputs) + node->plugin->getLatencySamples();
+            if (std::any_of(node->audioInputs.begin(), node->audioInputs.end(), [](auto& input) { return input.delayLine != nullptr; }))
+            {
+                node->scratch.setSize(node->buffer.getNumChannels(), maxBlockSize);
+                node->scratch.clear();
+            }
+        }
+    }
+
+    m_latency = alignInputs(m_audioOutputs);
+    if (std::any_of(m_audioOutputs.begin(), m_audioOutputs.end(), [](auto& input) { return input.delayLine != nullptr; }))
+    {
+        m_outputScratch.setSize(numIOChannels, maxBlockSize);
+        m_outputScratch.clear();
+    }
+}
+
+void PluginGraph::setDelay(AudioInput& input, int delay, int maxBlockSize)
+{
+    input.delay = delay;
+    input.delayLine.reset();
+    if (delay <= 0)
+        return;
+
+    const int numChannels = input.source == inputNode ? m_numIOChannels : m_nodes[(size_t)input.source]->buffer.getNumChannels();
+    input.delayLine = std::make_unique<CircularBuffer>(numChannels, delay + maxBlockSize);
+    input.delayLine->pushSilence(delay);
+}
+
+bool PluginGraph::createsCycle(const std::vector<Connection>& connections, const Connection& connection)
+{
+    if (connection.source == connection.destination)
+        return true;
+
+    // a loop means the source is already reachable from the destination
+    std::vector<int> stack { connection.destination };
+    std::vector<int> visited;
+    while (!stack.empty())
+    {
+        const int n = stack.back();
+        stack.pop_back();
+        if (n == connection.source)
+            return true;
+        if (std::find(visited.begin(), visited.end(), n) != visited.end())
+            continue;
+        visited.push_back(n);
+
+        for (auto& c : connections)
+        {
+            if (c.source == n)
+                stack.push_back(c.destination);
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// processing
+//-----------------------------------------------------------------------------
+void PluginGraph::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    m_input = &buffer;
+    m_inputMidi = &midi;
+    m_numSamples = std::min(buffer.getNumSamples(), m_outputBuffer.getNumSamples());
+
+    for (auto& level : m_levels)
+    {
+        if (level.empty())
+            continue;
+        m_pending = (int)level.size();
+
+        // hand all but the first node to the workers, and do the first one ourselves
+        for (size_t i = 1; i < level.size(); i++)
+        {
+            if (!m_scheduler || !m_scheduler->submit(*level[i], true))
+                level[i]->run();
+        }
+        level[0]->run();
+
+        // The next level reads this level's output. Nodes no worker has picked up yet (all of them
+        // may be busy with other hosts' blocks) are run here rather than waited for.
+        while (m_pending.load() > 0)
+        {
+            if (!m_scheduler || !m_scheduler->runUrgentJob())
+                std::this_thread::yield();
+        }
+    }
+
+    // mix the output, the input is still needed for direct input -> output connections
+    for (int c = 0; c < m_outputBuffer.getNumChannels(); c++)
+        juce::FloatVectorOperations::clear(m_outputBuffer.getWritePointer(c), m_numSamples);
+    for (auto& input : m_audioOutputs)
+        addAudio(input, m_outputBuffer, m_outputScratch, m_numSamples);
+
+    m_outputMidi.clear();
+    for (int source : m_midiOutputs)
+        addMidi(source, m_outputMidi, m_numSamples);
+
+    for (int c = 0; c < buffer.getNumChannels(); c++)
+    {
+        if (c < m_outputBuffer.getNumChannels())
+            juce::FloatVectorOperations::copy(buffer.getWritePointer(c), m_outputBuffer.getReadPointer(c), m_numSamples);
+        else
+            juce::FloatVectorOperations::clear(buffer.getWritePointer(c), m_numSamples);
+    }
+    midi.swapWith(m_outputMidi);
+}
+
+void PluginGraph::Node::run()
+{
+    const int numSamples = graph->m_numSamples;
+
+    for (int c = 0; c < buffer.getNumChannels(); c++)
+        juce::FloatVectorOperations::clear(buffer.getWritePointer(c), numSamples);
+    for (auto& input : audioInputs)
+        graph->addAudio(input, buffer, scratch, numSamples);
+
+    midi.clear();
+    for (int source : midiInputs)
+        graph->addMidi(source, midi, numSamples);
+
+    // a bypassed node passes its mixed inputs on
+    if (!plugin->isSuspended())
+    {
+        juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        plugin->processBlock(block, midi);
+    }
+
+    graph->m_pending.fetch_sub(1);
+}
+
+const juce::AudioBuffer<float>& PluginGraph::getSourceBuffer(int source) const
+{
+    return source == inputNode ? *m_input : m_nodes[(size_t)source]->buffer;
+}
+
+void PluginGraph::addAudio(AudioInput& input, juce::AudioBuffer<float>& destination, juce::AudioBuffer<float>& scratch, int numSamples)
+{
+    const auto* sourceBuffer = &getSourceBuffer(input.source);
+
+    // compensated connections go through their delay line first
+    if (input.delayLine)
+    {
+        const int numDelayed = std::min(input.delayLine->getNumChannels(), scratch.getNumChannels());
+        input.delayLine->push(sourceBuffer->getArrayOfReadPointers(), sourceBuffer->getNumChannels(), numSamples);
+        input.delayLine->pop(scratch.getArrayOfWritePointers(), numDelayed, numSamples);
+        sourceBuffer = &scratch;
+    }
+
+    const int numChannels = std::min(sourceBuffer->getNumChannels(), destination.getNumChannels());
+    for (int c = 0; c < numChannels; c++)
+        juce::FloatVectorOperations::add(destination.getWritePointer(c), sourceBuffer->getReadPointer(c), numSamples);
+}
+
+void PluginGraph::addMidi(int source, juce::MidiBuffer& destination, int numSamples) const
+{
+    const auto& sourceMidi = source == inputNode ? *m_inputMidi : m_nodes[(size_t)source]->midi;
+    destination.addEvents(sourceMidi, 0, numSamples, 0);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "CircularBuffer.h"
+#include "ParallelScheduler.h"
+#include "PluginChain.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// PluginGraph
+// A compiled routing graph between the plugins of a PluginHost. Nodes are the
+// host's stages, edges carry audio (summed at the destination) or MIDI (merged).
+// The graph is sorted into levels of nodes that only depend on earlier levels,
+// and the nodes of a level run concurrently on the shared ParallelScheduler.
+// Audio connections on paths with less plugin latency than others going to the
+// same destination get a delay line, so everything arrives aligned.
+// A PluginGraph is immutable once compiled - edits compile a new one on the
+// message thread, which is swapped in along with the rest of the processing config.
+//-----------------------------------------------------------------------------
+class PluginGraph
+{
+public:
+
+    // node ids of the graph's own input (ChucK's audio and the MIDI functions) and output
+    static constexpr int inputNode = -1;
+    static constexpr int outputNode = -2;
+
+    struct Connection
+    {
+        int source = inputNode;
+        int destination = outputNode;
+        bool midi = false;
+
+        bool operator==(const Connection& other) const
+        {
+            return source == other.source && destination == other.destination && midi == other.midi;
+        }
+    };
+
+    // Compile the graph for the given nodes and connections (message thread)
+    // Nodes without a path to the output are left out of the schedule.
+    PluginGraph(const PluginList& plugins, const std::vector<Connection>& connections, int maxBlockSize,
+                std::shared_ptr<ParallelScheduler> scheduler);
+
+    // whether adding connection to the existing ones would create a feedback loop
+    static bool createsCycle(const std::vector<Connection>& connections, const Connection& connection);
+
+    // latency of the longest (compensated) path to the output, in samples
+    int getLatency() const { return m_latency; }
+
+    // Process one block (audio thread)
+    // buffer and midi hold the graph input on entry and the graph output on return.
+    void process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi);
+
+private:
+
+    // an audio connection into a node or the output
+    struct AudioInput
+    {
+        // source node index (or inputNode)
+        int source = inputNode;
+        // delay compensation in samples, and the delay line for it (null when 0)
+        int delay = 0;
+        std::unique_ptr<CircularBuffer> delayLine;
+    };
+
+    struct Node : ParallelScheduler::Job
+    {
+        // mix the inputs and run the plugin (any thread)
+        void run() override;
+
+        PluginGraph* graph = nullptr;
+        int index = 0;
+        std::shared_ptr<juce::AudioPluginInstance> plugin;
+        // node's own audio, holds the mixed inputs before and the plugin output after processing
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        // delayed input is read into here before it's mixed (only allocated if needed)
+        juce::AudioBuffer<float> scratch;
+        std::vector<AudioInput> audioInputs;
+        // source node indices (or inputNode)
+        std::vector<int> midiInputs;
+    };
+
+    // source buffer of a connection for the current block
+    const juce::AudioBuffer<float>& getSourceBuffer(int source) const;
+    // give the connection a delay line if it needs one (message thread)
+    void setDelay(AudioInput& input, int delay, int maxBlockSize);
+    // add the audio / MIDI of a source node (or the graph input) for the current block
+    void addAudio(AudioInput& input, juce::AudioBuffer<float>& destination, juce::AudioBuffer<float>& scratch, int numSamples);
+    void addMidi(int source, juce::MidiBuffer& destination, int numSamples) const;
+
+    // one node per stage, unscheduled nodes are never run
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    // nodes grouped by dependency depth, each level only reads from earlier ones
+    std::vector<std::vector<Node*>> m_levels;
+    // nodes feeding the graph output
+    std::vector<AudioInput> m_audioOutputs;
+    std::vector<int> m_midiOutputs;
+    // output accumulation (the input buffer is still needed while the output is mixed)
+    juce::AudioBuffer<float> m_outputBuffer;
+    juce::AudioBuffer<float> m_outputScratch;
+    juce::MidiBuffer m_outputMidi;
+    int m_numIOChannels = 0;
+    int m_latency = 0;
+
+    // the block being processed (audio thread)
+    const juce::AudioBuffer<float>* m_input = nullptr;
+    const juce::MidiBuffer* m_inputMidi = nullptr;
+    int m_numSamples = 0;
+    // nodes of the current level which haven't finished yet
+    std::atomic<int> m_pending { 0 };
+
+    std::shared_ptr<ParallelScheduler> m_scheduler;
+};
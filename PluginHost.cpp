@@ -4,12 +4,14 @@
 
 #include "PluginHost.h"
 #include "Utilities.h"
+#include "Interleave.h"
 
 #include <stdio.h>
 #include <limits.h>
 #include <math.h>
 #include <iostream>
 #include <algorithm>
+#include <utility>
 
 //-----------------------------------------------------------------------------
 // constructor/destructor
@@ -28,6 +30,39 @@ CK_DLL_MFUN(pluginhost_getParamDisplay);
 CK_DLL_MFUN(pluginhost_numParams);
 CK_DLL_MFUN(pluginhost_numNonMidiParams);
 CK_DLL_MFUN(pluginhost_findParam);
+CK_DLL_MFUN(pluginhost_getParamId);
+CK_DLL_MFUN(pluginhost_findParamId);
+CK_DLL_MFUN(pluginhost_nonMidiParam);
+CK_DLL_MFUN(pluginhost_getParamDefault);
+CK_DLL_MFUN(pluginhost_getParamSteps);
+CK_DLL_MFUN(pluginhost_setParams);
+CK_DLL_MFUN(pluginhost_setParamsIfChanged);
+CK_DLL_MFUN(pluginhost_getParams);
+CK_DLL_MFUN(pluginhost_paramChanged);
+CK_DLL_MFUN(pluginhost_recvParamChange);
+CK_DLL_MFUN(pluginhost_paramChangeStage);
+CK_DLL_MFUN(pluginhost_paramChangeIndex);
+CK_DLL_MFUN(pluginhost_paramChangeValue);
+
+//-----------------------------------------------------------------------------
+// parameter automation functions
+//-----------------------------------------------------------------------------
+CK_DLL_MFUN(pluginhost_rampParam);
+CK_DLL_MFUN(pluginhost_rampParamExp);
+CK_DLL_MFUN(pluginhost_rampParamSegments);
+CK_DLL_MFUN(pluginhost_paramLFO);
+CK_DLL_MFUN(pluginhost_stopParam);
+CK_DLL_MFUN(pluginhost_modulate);
+CK_DLL_MFUN(pluginhost_unmodulate);
+CK_DLL_MFUN(pluginhost_modInput);
+
+// LFO shapes
+static t_CKINT pluginhost_lfo_sine = ParameterAutomation::sine;
+static t_CKINT pluginhost_lfo_triangle = ParameterAutomation::triangle;
+static t_CKINT pluginhost_lfo_saw = ParameterAutomation::saw;
+static t_CKINT pluginhost_lfo_square = ParameterAutomation::square;
+// number of modulation inputs
+static t_CKINT pluginhost_mod_inputs = PluginHost::maxModInputs;
 
 //-----------------------------------------------------------------------------
 // program functions
@@ -41,6 +76,11 @@ CK_DLL_MFUN(pluginhost_programName);
 // other functions
 //-----------------------------------------------------------------------------
 CK_DLL_MFUN(pluginhost_load);
+CK_DLL_MFUN(pluginhost_preload);
+CK_DLL_MFUN(pluginhost_preloaded);
+CK_DLL_MFUN(pluginhost_clearPreloaded);
+CK_DLL_MFUN(pluginhost_clone);
+CK_DLL_MFUN(pluginhost_cloneStage);
 CK_DLL_MFUN(pluginhost_name);
 CK_DLL_MFUN(pluginhost_vendor);
 CK_DLL_MFUN(pluginhost_saveState);
@@ -49,11 +89,38 @@ CK_DLL_MFUN(pluginhost_showEditor);
 CK_DLL_MFUN(pluginhost_hideEditor);
 CK_DLL_MFUN(pluginhost_asyncEventRunning);
 CK_DLL_MFUN(pluginhost_waitForAsyncEvents);
+CK_DLL_MFUN(pluginhost_lastOp);
+CK_DLL_MFUN(pluginhost_merged);
 CK_DLL_MFUN(pluginhost_setForceSynchronous);
 CK_DLL_MFUN(pluginhost_getForceSynchronous);
 CK_DLL_MFUN(pluginhost_setBlockSize);
 CK_DLL_MFUN(pluginhost_getBlockSize);
+CK_DLL_MFUN(pluginhost_setMaxBlockSize);
+CK_DLL_MFUN(pluginhost_getMaxBlockSize);
+CK_DLL_MFUN(pluginhost_setMinSubBlockSize);
+CK_DLL_MFUN(pluginhost_getMinSubBlockSize);
+CK_DLL_MFUN(pluginhost_setCrossfade);
+CK_DLL_MFUN(pluginhost_getCrossfade);
+CK_DLL_MFUN(pluginhost_setDirectProcessing);
+CK_DLL_MFUN(pluginhost_getDirectProcessing);
+CK_DLL_MFUN(pluginhost_setAsync);
+CK_DLL_MFUN(pluginhost_getAsync);
+CK_DLL_MFUN(pluginhost_setParallel);
+CK_DLL_MFUN(pluginhost_getParallel);
+CK_DLL_MFUN(pluginhost_overruns);
+CK_DLL_SFUN(pluginhost_setWorkers);
+CK_DLL_SFUN(pluginhost_getWorkers);
+CK_DLL_SFUN(pluginhost_clearPluginCache);
+CK_DLL_SFUN(pluginhost_scanPlugins);
+CK_DLL_SFUN(pluginhost_scanPluginsIn);
+CK_DLL_SFUN(pluginhost_scanningPlugins);
+CK_DLL_SFUN(pluginhost_searchPlugins);
+CK_DLL_SFUN(pluginhost_foundPluginPath);
+CK_DLL_SFUN(pluginhost_foundPluginName);
+CK_DLL_SFUN(pluginhost_foundPluginVendor);
+CK_DLL_SFUN(pluginhost_foundPluginCategory);
 CK_DLL_MFUN(pluginhost_latency);
+CK_DLL_MFUN(pluginhost_totalLatency);
 CK_DLL_MFUN(pluginhost_setBypass);
 CK_DLL_MFUN(pluginhost_getBypass);
 CK_DLL_MFUN(pluginhost_reset);
@@ -102,10 +169,84 @@ CK_DLL_MFUN(pluginhost_aftertouchChannel_default);
 CK_DLL_MFUN(pluginhost_controlChange);
 CK_DLL_MFUN(pluginhost_controlChange_default);
 CK_DLL_MFUN(pluginhost_midiMsg);
+CK_DLL_MFUN(pluginhost_noteOnArray);
+CK_DLL_MFUN(pluginhost_noteOnArray_default);
+CK_DLL_MFUN(pluginhost_noteOffArray);
+CK_DLL_MFUN(pluginhost_noteOffArray_default);
+CK_DLL_MFUN(pluginhost_midiMsgArray);
+CK_DLL_MFUN(pluginhost_midiOut);
+CK_DLL_MFUN(pluginhost_recvMidiOut);
+CK_DLL_MFUN(pluginhost_midiOutData);
+CK_DLL_MFUN(pluginhost_midiOutTime);
+CK_DLL_MFUN(pluginhost_forwardMidi);
 CK_DLL_MFUN(pluginhost_addQWERTYMidiInput);
 CK_DLL_MFUN(pluginhost_removeQWERTYMidiInput);
 CK_DLL_MFUN(pluginhost_toggleQWERTYMidiInput);
 
+//-----------------------------------------------------------------------------
+// PluginChain functions
+//-----------------------------------------------------------------------------
+CK_DLL_MFUN(pluginchain_add);
+CK_DLL_MFUN(pluginchain_insert);
+CK_DLL_MFUN(pluginchain_load);
+CK_DLL_MFUN(pluginchain_remove);
+CK_DLL_MFUN(pluginchain_move);
+CK_DLL_MFUN(pluginchain_size);
+CK_DLL_MFUN(pluginchain_setParam);
+CK_DLL_MFUN(pluginchain_getParam);
+CK_DLL_MFUN(pluginchain_getParamName);
+CK_DLL_MFUN(pluginchain_getParamDisplay);
+CK_DLL_MFUN(pluginchain_numParams);
+CK_DLL_MFUN(pluginchain_findParam);
+CK_DLL_MFUN(pluginchain_setParams);
+CK_DLL_MFUN(pluginchain_setParamsIfChanged);
+CK_DLL_MFUN(pluginchain_getParams);
+CK_DLL_MFUN(pluginchain_program);
+CK_DLL_MFUN(pluginchain_name);
+CK_DLL_MFUN(pluginchain_saveState);
+CK_DLL_MFUN(pluginchain_loadState);
+CK_DLL_MFUN(pluginchain_showEditor);
+CK_DLL_MFUN(pluginchain_hideEditor);
+CK_DLL_MFUN(pluginchain_setBypass);
+CK_DLL_MFUN(pluginchain_getBypass);
+
+//-----------------------------------------------------------------------------
+// PluginGraph functions
+//-----------------------------------------------------------------------------
+CK_DLL_CTOR(plugingraph_ctor);
+CK_DLL_MFUN(plugingraph_connect);
+CK_DLL_MFUN(plugingraph_connectMidi);
+CK_DLL_MFUN(plugingraph_disconnect);
+CK_DLL_MFUN(plugingraph_disconnectMidi);
+CK_DLL_MFUN(plugingraph_disconnectAll);
+
+// node ids of the graph's own input and output
+static t_CKINT plugingraph_in = PluginGraph::inputNode;
+static t_CKINT plugingraph_out = PluginGraph::outputNode;
+
+//-----------------------------------------------------------------------------
+// PluginOp functions
+//-----------------------------------------------------------------------------
+CK_DLL_DTOR(pluginop_dtor);
+CK_DLL_MFUN(pluginop_id);
+CK_DLL_MFUN(pluginop_status);
+CK_DLL_MFUN(pluginop_done);
+CK_DLL_MFUN(pluginop_ok);
+CK_DLL_MFUN(pluginop_error);
+CK_DLL_MFUN(pluginop_cancel);
+
+static t_CKINT pluginop_pending = AsyncOperation::pending;
+static t_CKINT pluginop_done_status = AsyncOperation::done;
+static t_CKINT pluginop_failed = AsyncOperation::failed;
+static t_CKINT pluginop_cancelled = AsyncOperation::cancelled;
+
+//-----------------------------------------------------------------------------
+// PluginMod functions
+//-----------------------------------------------------------------------------
+CK_DLL_CTOR(pluginmod_ctor);
+CK_DLL_DTOR(pluginmod_dtor);
+CK_DLL_TICKF(pluginmod_tick);
+
 //-----------------------------------------------------------------------------
 // tick function
 //-----------------------------------------------------------------------------
@@ -113,6 +254,10 @@ CK_DLL_TICKF(pluginhost_tick);
 
 // data offset for internal class
 t_CKINT pluginhost_data_offset = 0;
+// PluginOp's shared_ptr<AsyncOperation>
+t_CKINT pluginop_data_offset = 0;
+// PluginMod's ModulationInput
+t_CKINT pluginmod_data_offset = 0;
 
 
 //-----------------------------------------------------------------------------
@@ -122,45 +267,91 @@ t_CKINT pluginhost_data_offset = 0;
 //-------------------------------------------------------------------------
 // constructor/destructor
 //-------------------------------------------------------------------------
-PluginHost::PluginHost( t_CKFLOAT fs )
-:
-  m_renderBuffer(maxChannels, 16),
-  m_inputBuffer(maxChannels, maxBufferSize + 1),
-  m_outputBuffer(maxChannels, maxBufferSize + 1)
+PluginHost::PluginHost( t_CKFLOAT fs, Chuck_VM * vm, CK_DL_API api )
 {
     m_srate = fs;
+    m_vm = vm;
+    m_api = api;
+    m_eventBuffer = m_api->vm->create_event_buffer(m_vm);
+    m_publishedStages = std::make_shared<const StageViews>();
     // default block size
     m_blockSize = 16;
-    // resize render buffer to match default block size
-    m_renderBuffer.setSize(maxChannels, m_blockSize);
-    m_renderBuffer.clear();
-    
-    // register plugin formats
-    m_formatManager.addDefaultFormats();
+    // initial config without a plugin - nothing is ticking yet so it can be installed directly
+    m_audioConfig = createConfig({}).release();
+    // enough for dense MIDI, draining the queue won't have to allocate on the audio thread
+    m_outputMidi.ensureSize(4096);
+    m_subBlockMidi.ensureSize(4096);
+    m_splitOutputMidi.ensureSize(4096);
+
+    // plugin formats are registered once, by the first host
+    m_catalog = PluginCatalog::getShared();
+    m_pool = PluginPool::getShared();
+
+    ConfigReclaimer::getInstance().add(this);
 }
 
 PluginHost::~PluginHost()
 {
     // wait for any pending async events just in case
     waitForAsyncEvents(100);
+    ConfigReclaimer::getInstance().remove(this);
+
+    // the destructor runs on the VM thread, so the ChucK objects can be released here
+    setMidiForward(nullptr, nullptr);
+    setModulationInput(nullptr, nullptr);
+    if (m_midiOutEvent)
+        m_api->object->release((Chuck_Object *)m_midiOutEvent);
+    if (m_paramChangedEvent)
+        m_api->object->release((Chuck_Object *)m_paramChangedEvent);
+    for (auto& entry : m_operationObjects)
+        m_api->object->release(entry.object);
+    m_operationObjects.clear();
+    for (auto& entry : m_heldObjects)
+        m_api->object->release(entry.object);
+    m_heldObjects.clear();
+    m_api->vm->destroy_event_buffer(m_vm, m_eventBuffer);
+
+    // collect all configs, the audio thread is no longer ticking so they can all be taken
+    std::vector<std::shared_ptr<ProcessingConfig>> configs;
+    for (auto* config : { m_audioConfig, m_fadeConfig, m_pendingConfig.exchange(nullptr) })
+    {
+        if (config)
+            configs.emplace_back(config);
+    }
+    for (auto& slot : m_retiredConfigs)
+    {
+        if (auto* config = slot.exchange(nullptr))
+            configs.emplace_back(config);
+    }
+    m_audioConfig = nullptr;
+    m_fadeConfig = nullptr;
+
+    // an async worker may still be processing the last block it was handed
+    waitForAsyncProcessors();
 
-    // delete the plugin editor on the message thread
-    if (m_editor)
+    // no more rebuilds for latency / parameter changes
+    for (auto& weak : m_listenedPlugins)
     {
-        std::shared_ptr<PluginEditorWindow> editor = std::move(m_editor);
-        juce::MessageManager::callAsync([editor]() {});
+        if (auto plugin = weak.lock())
+            plugin->removeListener(&m_pluginListener);
     }
+    m_pluginListener.cancelPendingUpdate();
 
-    // delete the plugin instance on the message thread
-    if (m_plugin)
+    // detach playhead before destruction as m_playHead will be destroyed
+    // should maybe extend the lifetime of the playhead instead
+    for (auto& stage : m_stages)
+        stage.plugin->setPlayHead(nullptr);
+    for (auto& config : configs)
     {
-        // detach playhead before destruction as m_playHead will be destroyed
-        // should maybe extend the lifetime of the playhead instead
-        m_plugin->setPlayHead(nullptr);
+        for (auto& plugin : config->plugins)
+            plugin->setPlayHead(nullptr);
+    }
 
-        // destroy the plugin on the main thread
-        std::shared_ptr<juce::AudioPluginInstance> plugin = std::move(m_plugin);
-        juce::MessageManager::callAsync([plugin]() {});
+    // destroy the configs, plugin instances and editors on the main thread
+    {
+        auto stages = std::make_shared<std::vector<Stage>>(std::move(m_stages));
+        auto views = std::atomic_exchange(&m_publishedStages, std::shared_ptr<const StageViews>());
+        juce::MessageManager::callAsync([stages, views, configs]() {});
     }
 
     // destroy qwerty window
@@ -176,10 +367,33 @@ PluginHost::~PluginHost()
 //-------------------------------------------------------------------------
 void PluginHost::tick( SAMPLE * in, SAMPLE * out, int nframes )
 {
-    constexpr int numChannels = maxChannels;
+    // ChucK frames always hold maxChannels samples, only numChannels of them are exchanged with the plugin
+    constexpr int frameSize = maxChannels;
 
-    // fine when there is no contention
-    juce::SpinLock::ScopedLockType lock(m_audioLock);
+    // lets the message thread know when it is safe to touch the plugin, see runWithPluginDetached()
+    struct ProcessingScope
+    {
+        explicit ProcessingScope(std::atomic<bool>& f) : flag(f) { flag.store(true); }
+        ~ProcessingScope() { flag.store(false); }
+        std::atomic<bool>& flag;
+    } processingScope(m_audioThreadProcessing);
+
+    // pick up the latest published config - lock free, the message thread never blocks us
+    ProcessingConfig& config = acquireConfig();
+    juce::AudioBuffer<float>& renderBuffer = config.renderBuffer;
+    const int blockSize = config.blockSize;
+    const int numChannels = config.numChannels;
+    // time of the first frame, shreds have already run for it
+    const int64_t tickTime = getNow();
+    m_tickEndTime = tickTime + nframes;
+
+    // let the shreds know about parameter changes the plugins reported since the last tick
+    if (m_paramChangedEnabled && m_paramsChanged->exchange(false))
+        m_api->vm->queue_event(m_vm, m_paramChangedEvent, 1, m_eventBuffer);
+
+    // and about finished operations
+    if (!m_operationObjects.empty() || !m_heldObjects.empty())
+        updateOperationObjects();
 
     // advance playhead if playing
     constexpr bool advancePlayhead = false;
@@ -195,494 +409,1564 @@ void PluginHost::tick( SAMPLE * in, SAMPLE * out, int nframes )
         m_playHead.setTimeInSeconds(m_playHead.getTimeInSeconds() + (double)nframes / m_srate);
     }
 
-    if (nframes == m_blockSize)
+    // pass the frames straight to the plugin (no accumulation delay) when they make up a whole block,
+    // or always when processing directly
+    if (nframes == blockSize || config.directProcessing)
     {
-        // clear old output midi
-        m_outputMidi.clear();
-        if (m_inputMidi.getNumEvents() > 0)
-        {
-            m_outputMidi.addEvents(m_inputMidi, 0, m_blockSize, 0);
-            m_inputMidi.clear();
-        }
+        processDirect(config, in, out, nframes, tickTime);
+        return;
+    }
 
-        // inject keyboard MIDI
-        m_keyboardState.processNextMidiBuffer(m_outputMidi, 0, nframes, true);
+    // the rings only write numChannels samples per frame
+    if (numChannels < frameSize)
+        juce::FloatVectorOperations::clear(out, nframes * frameSize);
 
-        if (m_plugin)
-        {
-            // de-interleave input to m_renderBuffer
-            for(int c = 0; c < numChannels; c++)
-            {
-                float* dest = m_renderBuffer.getWritePointer(c);
-                for(int f = 0; f < nframes; f++)
-                    dest[f] = in[f * numChannels + c];
-            }
+    // move whole runs of frames through the rings - a run ends on the frame which completes a block
+    for(int f = 0; f < nframes;)
+    {
+        const int needed = std::max(1, blockSize - config.inputBuffer.getAvailableSamples());
+        const int run = std::min(nframes - f, needed);
 
-            // check the number of channels that a plugin actually wants (some might require sidechain inputs)
-            const int totalNumChannels = std::max(m_plugin->getTotalNumInputChannels(), m_plugin->getTotalNumOutputChannels());
-            // currently we don't do anything to accomodate this, but we eventually will make sure plugins get the channels they want
-            if (totalNumChannels > maxChannels)
-                std::cout << "PluginHost: Channel mismatch, this might cause issues..." << std::endl;
+        config.inputBuffer.pushInterleaved(in + f * frameSize, frameSize, numChannels, run);
+        if (!config.modTargets.empty())
+            config.modInputBuffer.pushHeld(getModulationFrame(), maxModInputs, run);
 
-            m_plugin->processBlock(m_renderBuffer, m_outputMidi);
+        // the frames before the last one in the run are output before the block is processed,
+        // this keeps the accumulation delay at exactly blockSize - 1 samples
+        config.outputBuffer.popInterleaved(out + f * frameSize, frameSize, numChannels, run - 1);
+        f += run - 1;
 
-            // interleave output from m_renderBuffer
-            for(int c = 0; c < numChannels; c++)
+        // check if we have enough samples to process a block
+        if (config.inputBuffer.getAvailableSamples() >= blockSize)
+        {
+            if (config.inputBuffer.pop(renderBuffer.getArrayOfWritePointers(), numChannels, blockSize))
             {
-                const float* src = m_renderBuffer.getReadPointer(c);
-                for(int f = 0; f < nframes; f++)
-                    out[f * numChannels + c] = src[f];
+                if (!config.modTargets.empty())
+                    config.modInputBuffer.pop(config.modRenderBuffer.getArrayOfWritePointers(), maxModInputs, blockSize);
+
+                // the block ends with frame f
+                renderBlock(config, blockSize, tickTime + f - blockSize + 1);
+                config.outputBuffer.push(renderBuffer.getArrayOfReadPointers(), numChannels, blockSize);
             }
         }
-        else
-        {
-            // passthrough
-            for(int i = 0; i < nframes * numChannels; i++)
-                out[i] = in[i];
-        }
-        return;
+
+        config.outputBuffer.popInterleaved(out + f * frameSize, frameSize, numChannels, 1);
+        f++;
     }
+}
+
+void PluginHost::processDirect(ProcessingConfig& config, const SAMPLE* in, SAMPLE* out, int nframes, int64_t tickTime)
+{
+    constexpr int frameSize = maxChannels;
+    auto& renderBuffer = config.renderBuffer;
+    const int numChannels = config.numChannels;
 
-    for(int f = 0; f < nframes; f++)
+    if (config.plugins.empty())
     {
-        float inputs[numChannels];
-        for(int c = 0; c < numChannels; c++)
-            inputs[c] = in[f * numChannels + c];
-        m_inputBuffer.push(inputs, numChannels);
+        renderBlock(config, nframes, tickTime);
 
-        // check if we have enough samples to process a block
-        if (m_inputBuffer.getAvailableSamples() >= m_blockSize)
-        {
-            if (m_inputBuffer.pop(m_renderBuffer))
-            {
-                // clear old output midi
-                m_outputMidi.clear();
-                if (m_inputMidi.getNumEvents() > 0)
-                {
-                    m_outputMidi.addEvents(m_inputMidi, 0, m_blockSize, 0);
-                    m_inputMidi.clear();
-                }
+        // passthrough
+        for(int i = 0; i < nframes * frameSize; i++)
+            out[i] = in[i];
+        return;
+    }
 
-                // inject keyboard MIDI
-                m_keyboardState.processNextMidiBuffer(m_outputMidi, 0, m_blockSize, true);
+    // unused channels are silent
+    if (numChannels < frameSize)
+        juce::FloatVectorOperations::clear(out, nframes * frameSize);
 
-                if (m_plugin)
-                {
-                    // check the number of channels that a plugin actually wants (some might require sidechain inputs)
-                    const int totalNumChannels = std::max(m_plugin->getTotalNumInputChannels(), m_plugin->getTotalNumOutputChannels());
-                    // currently we don't do anything to accomodate this, but we eventually will make sure plugins get the channels they want
-                    if (totalNumChannels > maxChannels)
-                        std::cout << "PluginHost: Channel mismatch, this might cause issues..." << std::endl;
+    // variable sized blocks, never more than the plugin was prepared for
+    for (int offset = 0; offset < nframes;)
+    {
+        const int chunk = std::min(nframes - offset, renderBuffer.getNumSamples());
 
-                    m_plugin->processBlock(m_renderBuffer, m_outputMidi);
-                }
-                
-                m_outputBuffer.push(m_renderBuffer);
-            }
+        // de-interleave input to renderBuffer
+        interleave::deinterleave(in + offset * frameSize, frameSize, renderBuffer.getArrayOfWritePointers(), numChannels, chunk);
+        if (!config.modTargets.empty())
+        {
+            const float* modFrame = getModulationFrame();
+            for (int c = 0; c < maxModInputs; c++)
+                juce::FloatVectorOperations::fill(config.modRenderBuffer.getWritePointer(c), modFrame[c], chunk);
         }
 
-        float outputs[numChannels];
-        m_outputBuffer.pop(outputs, numChannels);
-        
-        for(int c = 0; c < numChannels; c++)
-            out[f * numChannels + c] = outputs[c];
+        renderBlock(config, chunk, tickTime + offset);
+
+        // interleave output from renderBuffer
+        interleave::interleave(renderBuffer.getArrayOfReadPointers(), out + offset * frameSize, frameSize, numChannels, chunk);
+        offset += chunk;
     }
 }
 
-//-------------------------------------------------------------------------
-// parameter accessors
-//-------------------------------------------------------------------------
-int PluginHost::getNumParams()
+void PluginHost::renderBlock(ProcessingConfig& config, int numSamples, int64_t blockTime)
 {
-    if (!m_plugin) return 0;
-    return m_plugin->getParameters().size();
-}
+    // clear old output midi and pick up the MIDI sent during this block
+    m_outputMidi.clear();
+    m_midiQueue.drainInto(m_outputMidi, blockTime, numSamples);
 
-int PluginHost::getNumNonMidiParams()
-{
-    if (!m_plugin) return 0;
-    int count = 0;
-    auto& params = m_plugin->getParameters();
-    for (auto* p : params)
+    // inject keyboard MIDI
+    m_keyboardState.processNextMidiBuffer(m_outputMidi, 0, numSamples, true);
+
+    if (config.plugins.empty())
     {
-        if (!p->getName(128).startsWith("MIDI CC"))
-            count++;
+        // nothing to apply the changes to
+        applyParameterChanges(config, blockTime + numSamples);
+        return;
     }
-    return count;
-}
-
-std::string PluginHost::getParamName(int index)
-{
-    if (!m_plugin) return "";
-    auto& params = m_plugin->getParameters();
-    if (index < 0 || index >= params.size()) return "";
-    return params[index]->getName(128).toStdString();
-}
 
-float PluginHost::getParam(int index)
-{
-    if (!m_plugin) return 0.0f;
-    auto& params = m_plugin->getParameters();
-    if (index < 0 || index >= params.size()) return 0.0f;
-    return params[index]->getValue();
-}
+    // channels the plugins want beyond what ChucK provides (e.g. sidechains) get silence
+    auto& renderBuffer = config.renderBuffer;
+    for (int c = config.numChannels; c < renderBuffer.getNumChannels(); c++)
+        juce::FloatVectorOperations::clear(renderBuffer.getWritePointer(c), numSamples);
 
-float PluginHost::setParam(int index, float val)
-{
-    if (!m_plugin) return val;
-    auto& params = m_plugin->getParameters();
-    if (index < 0 || index >= params.size()) return val;
-    params[index]->setValue(val);
-    return val;
-}
+    // the replaced plugins keep running on the same input until they are faded out
+    const bool fading = m_fadeConfig && m_fadePosition < m_fadeLength;
+    if (fading)
+        renderFadingConfig(config, numSamples);
 
-int PluginHost::findParam(const std::string& name)
-{
-    if (!m_plugin) return -1;
-    auto& params = m_plugin->getParameters();
-    for (int i = 0; i < params.size(); ++i)
+    // The async worker has to stay exactly one whole block behind, so changes are applied at the block start.
+    // It may still be on the previous block, which the changes must not reach in the middle of. If it doesn't
+    // finish in time the block is skipped: it comes out silent and the changes wait for the next one.
+    if (config.asyncProcessor && !config.asyncProcessor->waitForBlock(numSamples))
     {
-        if (params[i]->getName(128).toStdString() == name)
-            return i;
+        for (int c = 0; c < renderBuffer.getNumChannels(); c++)
+            juce::FloatVectorOperations::clear(renderBuffer.getWritePointer(c), numSamples);
+        m_outputMidi.clear();
+        m_numOverruns++;
     }
-    return -1;
-}
+    else if (config.asyncProcessor)
+    {
+        applyParameterChanges(config, blockTime + numSamples);
+        m_automation.process(config.plugins, blockTime);
+        applyModulation(config, 0);
 
-std::string PluginHost::getParamLabel(int index)
-{
-    if (!m_plugin) return "";
-    auto& params = m_plugin->getParameters();
-    if (index < 0 || index >= params.size()) return "";
-    return params[index]->getLabel().toStdString();
-}
+        // refer to the first numSamples of the render buffer without allocating
+        juce::AudioBuffer<float> block(renderBuffer.getArrayOfWritePointers(), renderBuffer.getNumChannels(), numSamples);
+        config.asyncProcessor->process(config.plugins, block, m_outputMidi);
+    }
+    else
+        processWithAutomation(config, numSamples, blockTime);
 
-std::string PluginHost::getParamDisplay(int index)
-{
-    if (!m_plugin) return "";
-    auto& params = m_plugin->getParameters();
-    if (index < 0 || index >= params.size()) return "";
-    return params[index]->getCurrentValueAsText().toStdString();
-}
+    if (fading)
+        mixFadingConfig(config, numSamples);
 
-//-------------------------------------------------------------------------
-// metadata
-//-------------------------------------------------------------------------
-std::string PluginHost::getName() const
-{
-    return m_plugin ? m_plugin->getName().toStdString() : "";
+    deliverMidiOut(blockTime);
 }
 
-std::string PluginHost::getVendor() const
+void PluginHost::renderFadingConfig(const ProcessingConfig& config, int numSamples)
 {
-    return m_plugin ? m_plugin->getPluginDescription().manufacturerName.toStdString() : "";
+    // canCrossfade() made sure the block fits
+    auto& fadeBuffer = m_fadeConfig->renderBuffer;
+    for (int c = 0; c < fadeBuffer.getNumChannels(); c++)
+    {
+        if (c < config.numChannels)
+            fadeBuffer.copyFrom(c, 0, config.renderBuffer, c, 0, numSamples);
+        else
+            fadeBuffer.clear(c, 0, numSamples);
+    }
+
+    // no new MIDI, notes the old plugins are still playing ring out while they fade
+    m_fadeMidi.clear();
+    juce::AudioBuffer<float> block(fadeBuffer.getArrayOfWritePointers(), fadeBuffer.getNumChannels(), numSamples);
+    if (m_fadeConfig->graph)
+        m_fadeConfig->graph->process(block, m_fadeMidi);
+    else
+        processPluginChain(m_fadeConfig->plugins, block, m_fadeMidi);
 }
 
-//-------------------------------------------------------------------------
-// load / state
-//-------------------------------------------------------------------------
-void PluginHost::loadPlugin(const std::string& path)
+void PluginHost::mixFadingConfig(ProcessingConfig& config, int numSamples)
 {
-    juce::File file(path);
-    if (!file.exists())
+    // equal power (the two chains are unrelated), linear within the block
+    constexpr float halfPi = juce::MathConstants<float>::halfPi;
+    const float start = (float)m_fadePosition / (float)m_fadeLength;
+    const float end = std::min(1.0f, (float)(m_fadePosition + numSamples) / (float)m_fadeLength);
+    const float inStart = std::sin(start * halfPi), inEnd = std::sin(end * halfPi);
+    const float outStart = std::cos(start * halfPi), outEnd = std::cos(end * halfPi);
+
+    auto& renderBuffer = config.renderBuffer;
+    const auto& fadeBuffer = m_fadeConfig->renderBuffer;
+    for (int c = 0; c < config.numChannels; c++)
     {
-        std::cout << "PluginHost: File does not exist: " << path << std::endl;
-        return;
+        renderBuffer.applyGainRamp(c, 0, numSamples, inStart, inEnd);
+        if (c < fadeBuffer.getNumChannels())
+            renderBuffer.addFromWithRamp(c, 0, fadeBuffer.getReadPointer(c), numSamples, outStart, outEnd);
     }
+    m_fadePosition += numSamples;
+}
 
-    callOnMainThread([this, file, context = createAsyncEventContext()]
-    {
-        juce::AudioPluginFormat* format = nullptr;
-        for (int i = 0; i < m_formatManager.getNumFormats(); ++i)
-        {
-            auto* f = m_formatManager.getFormat(i);
-            std::cout << f->getName() << std::endl;
-            if (f->fileMightContainThisPluginType(file.getFullPathName()))
-            {
-                format = f;
-                break;
-            }
-        }
-
-        if (!format)
-        {
-            std::cout << "PluginHost: No format found for file " << file.getFileName() << std::endl;
-            return;
-        }
+void PluginHost::processWithAutomation(ProcessingConfig& config, int numSamples, int64_t blockTime)
+{
+    const int minSubBlockSize = m_minSubBlockSize.load();
+    const int64_t blockEndTime = blockTime + numSamples;
 
-        juce::OwnedArray<juce::PluginDescription> descriptions;
-        // use KnownPluginList to scan and add the file
-        m_knownPluginList.scanAndAddFile(file.getFullPathName(), false, descriptions, *format);
-        
-        if (descriptions.size() == 0)
+    int start = 0;
+    bool split = false;
+    while (start < numSamples)
+    {
+        // everything up to and including the first sample of the sub-block applies to it
+        applyParameterChanges(config, blockTime + start + 1);
+        m_automation.process(config.plugins, blockTime + start);
+        applyModulation(config, start);
+
+        // the sub-block runs until the next change, but at least minSubBlockSize samples
+        // (and a remainder shorter than that is not split off either)
+        // running ramps / LFOs and modulation inputs are updated every minSubBlockSize samples
+        int end = numSamples;
+        if (m_automation.isActive() || !config.modTargets.empty())
+            end = std::min(numSamples, start + minSubBlockSize);
+        int64_t nextTime = 0;
+        if (m_parameterQueue.getNextTime(nextTime) && nextTime < blockEndTime)
+            end = (int)std::min<int64_t>(end, std::max<int64_t>(start + minSubBlockSize, nextTime - blockTime));
+        if (numSamples - end < minSubBlockSize)
+            end = numSamples;
+
+        // the common case, no changes inside the block
+        if (start == 0 && end == numSamples)
         {
-            std::cout << "PluginHost: No plugin descriptions found in file." << std::endl;
+            processRange(config, 0, numSamples, m_outputMidi);
             return;
         }
 
-        std::cout << "PluginHost: Found " << descriptions.size() << " plugin descriptions. Loading the first one..." << std::endl;
-        
-        // destroy existing plugin asynchronously
+        if (!split)
         {
-            std::shared_ptr<juce::AudioPluginInstance> plugin = std::move(m_plugin);
-            juce::MessageManager::callAsync([plugin]() {});
+            m_splitOutputMidi.clear();
+            split = true;
         }
 
-        const auto callback = [this, context](std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String& error)
-        {
-            if (!instance)
-            {
-                std::cout << "PluginHost: Failed to load plugin: " << error << std::endl;
-                return;
-            }
+        // the sub-block's MIDI, shifted to start at 0 and back again afterwards
+        m_subBlockMidi.clear();
+        m_subBlockMidi.addEvents(m_outputMidi, start, end - start, -start);
+        processRange(config, start, end - start, m_subBlockMidi);
+        m_splitOutputMidi.addEvents(m_subBlockMidi, 0, end - start, start);
 
-            {
-                instance->prepareToPlay(m_srate, m_blockSize);
-                instance->setPlayHead(&m_playHead);
-
-                // request normal stereo layout
-                juce::AudioProcessor::BusesLayout normalLayout;
-                normalLayout.inputBuses.add(juce::AudioChannelSet::stereo());
-                normalLayout.outputBuses.add(juce::AudioChannelSet::stereo());
-                
-                if (instance->checkBusesLayoutSupported(normalLayout))
-                    instance->setBusesLayout(normalLayout);
-                else
-                {
-                    // the plugin doesn't like the normal layout it is going to force some other layout
-                }
+        start = end;
+    }
 
-                m_plugin = std::move(instance);
-            }
-            std::cout << "PluginHost: Successfully loaded: " << m_plugin->getName() << std::endl;
+    m_outputMidi.swapWith(m_splitOutputMidi);
+}
 
-            constexpr bool displayEditor = false;
-            if (displayEditor)
-                showEditor();
-        };
+void PluginHost::processRange(ProcessingConfig& config, int start, int numSamples, juce::MidiBuffer& midi)
+{
+    // refer to the range of the render buffer without allocating
+    auto& renderBuffer = config.renderBuffer;
+    juce::AudioBuffer<float> block(renderBuffer.getArrayOfWritePointers(), renderBuffer.getNumChannels(), start, numSamples);
+    if (config.graph)
+        config.graph->process(block, midi);
+    else
+        processPluginChain(config.plugins, block, midi);
+}
 
-        // create the plugin instance asynchronously
-        format->createPluginInstanceAsync(*descriptions[0], m_srate, m_blockSize, callback);
-    });
+void PluginHost::applyModulation(ProcessingConfig& config, int sample)
+{
+    // the inputs are decimated to one value per sub-block
+    for (auto& target : config.modTargets)
+    {
+        const float input = config.modRenderBuffer.getSample(target.input, sample);
+        target.param->setValue(juce::jlimit(0.0f, 1.0f, target.center + target.depth * input));
+    }
+}
 
-    // if we are forcing synchronicity, wait for the plugin to load
-    if (m_forceSynchronous)
-        waitForAsyncEvents();
+const float* PluginHost::getModulationFrame() const
+{
+    static const std::array<float, maxModInputs> silence {};
+    return m_modInput ? m_modInput->getFrame() : silence.data();
 }
 
-void PluginHost::showEditor()
+void PluginHost::applyParameterChanges(ProcessingConfig& config, int64_t time)
 {
-    callOnMainThread([this, context = createAsyncEventContext()]
+    ParameterQueue::Change change;
+    while (m_parameterQueue.popBefore(time, change))
     {
-        // if the editor already exists, just bring it to the front
-        if (m_editor)
-        {
-            m_editor->toFront(true);
-            return;
-        }
-        
-        // make sure that there is a plugin and that the plugin has an editor
-        if (!m_plugin || !m_plugin->hasEditor())
-            return;
-        
-        // create the editor
-        if (auto* editor = m_plugin->createEditorIfNeeded())
+        // the plugin may have been removed since the change was made
+        for (auto& plugin : config.plugins)
         {
-            ensureForegroundProcess();
-
-            // wrap the editor in a window
-            auto* window = new PluginEditorWindow(*this, editor);
-            window->addToDesktop();
-            window->toFront(true);
-            window->onClose = [this]() { m_editor.reset(); };
-            m_editor.reset(window);
+            if (plugin.get() != change.plugin)
+                continue;
+
+            auto& params = plugin->getParameters();
+            auto* param = change.index >= 0 && change.index < params.size() ? params[change.index] : nullptr;
+            if (change.type == ParameterQueue::Change::set && param)
+                param->setValue(change.value);
+            // a set also ends any ramp / LFO on the parameter
+            if (param || change.type == ParameterQueue::Change::stop)
+                m_automation.apply(change, param ? param->getValue() : 0.0f);
+            break;
         }
-    });
+    }
 }
 
-void PluginHost::hideEditor()
+void PluginHost::deliverMidiOut(int64_t blockTime)
 {
-    callOnMainThread([this, context = createAsyncEventContext()] { m_editor.reset(); });
+    if (m_outputMidi.getNumEvents() == 0 || (!m_midiOutEnabled && !m_midiForward))
+        return;
+
+    // messages are stamped with the block they come out with (in async mode that's one block after their input)
+    for (const auto metadata : m_outputMidi)
+    {
+        const int64_t time = blockTime + metadata.samplePosition;
+        if (m_midiOutEnabled)
+            m_midiOutQueue.push(time, metadata.data, metadata.numBytes);
+        // shreds and ticks take turns on the VM thread, so the target's queue still has a single producer at a time
+        if (m_midiForward)
+            m_midiForward->m_midiQueue.push(time, metadata.data, metadata.numBytes);
+    }
+
+    if (m_midiOutEnabled)
+        m_api->vm->queue_event(m_vm, m_midiOutEvent, 1, m_eventBuffer);
 }
 
-void PluginHost::saveState(const std::string& path)
+//-------------------------------------------------------------------------
+// parameter accessors
+//-------------------------------------------------------------------------
+// names, labels etc. come from the stage's ParameterTable, only values and display text are read from the plugin
+int PluginHost::getNumParams(int stage)
 {
-    callOnMainThread([this, path, context = createAsyncEventContext()]
-    {
-        if (!m_plugin)
-        {
-            std::cout << "PluginHost: No plugin loaded." << std::endl;
-            return;
-        }
+    auto table = getParameterTable(stage);
+    return table ? table->size() : 0;
+}
 
-        juce::MemoryBlock destData;
-        m_plugin->getStateInformation(destData);
+int PluginHost::getNumNonMidiParams(int stage)
+{
+    auto table = getParameterTable(stage);
+    return table ? (int)table->getNonMidiParams().size() : 0;
+}
 
-        juce::File file(path);
-        if (file.replaceWithData(destData.getData(), destData.getSize()))
-            std::cout << "PluginHost: State saved to " << path << std::endl;
-        else
-            std::cout << "PluginHost: Failed to save state to " << path << std::endl;
-    });
+std::string PluginHost::getParamName(int index, int stage)
+{
+    auto table = getParameterTable(stage);
+    auto* info = table ? table->get(index) : nullptr;
+    return info ? info->name : "";
 }
 
-void PluginHost::loadState(const std::string& path)
+float PluginHost::getParam(int index, int stage)
 {
-    callOnMainThread([this, path, context = createAsyncEventContext()]
-    {
-        if (!m_plugin)
-        {
-            std::cout << "PluginHost: No plugin loaded." << std::endl;
-            return;
-        }
+    auto plugin = getPlugin(stage);
+    if (!plugin) return 0.0f;
+    auto& params = plugin->getParameters();
+    if (index < 0 || index >= params.size()) return 0.0f;
+    return params[index]->getValue();
+}
 
-        juce::File file(path);
-        if (!file.existsAsFile())
-        {
-            std::cout << "PluginHost: File does not exist: " << path << std::endl;
-            return;
-        }
+float PluginHost::setParam(int index, float val, int stage)
+{
+    auto plugin = getPlugin(stage);
+    if (!plugin) return val;
+    auto& params = plugin->getParameters();
+    if (index < 0 || index >= params.size()) return val;
 
-        juce::MemoryBlock destData;
-        if (file.loadFileAsData(destData))
-        {
-            m_plugin->setStateInformation(destData.getData(), (int)destData.getSize());
-            std::cout << "PluginHost: State loaded from " << path << std::endl;
-        }
-        else
-            std::cout << "PluginHost: Failed to load state from " << path << std::endl;
-    });
+    setParamNow(plugin.get(), params[index], index, val, getNow());
+    return val;
 }
 
-//-------------------------------------------------------------------------
-// async / sync
-//-------------------------------------------------------------------------
-bool PluginHost::asyncEventRunning() const
+void PluginHost::setParamNow(juce::AudioProcessor* plugin, juce::AudioProcessorParameter* param, int index, float val, int64_t now)
 {
-    return m_asyncEventCount > 0;
+    // while we're being ticked the change is applied by the audio thread at the sample it's made at,
+    // otherwise (or if the queue is full) right away
+    if (now > m_tickEndTime || !m_parameterQueue.push({ now, plugin, index, val }))
+        param->setValue(val);
 }
 
-void PluginHost::waitForAsyncEvents(int timeoutMs) const
+int PluginHost::setParams(const int* indices, const float* values, int count, bool onlyIfChanged, int stage)
 {
-    const auto start = std::chrono::steady_clock::now();
-    while (m_asyncEventCount > 0)
+    auto plugin = getPlugin(stage);
+    if (!plugin) return 0;
+    auto& params = plugin->getParameters();
+    const int64_t now = getNow();
+
+    // a change still waiting in the queue isn't visible in getValue yet, so only compare when there is none
+    onlyIfChanged = onlyIfChanged && m_parameterQueue.empty();
+
+    int numSet = 0;
+    for (int i = 0; i < count; i++)
     {
-        if (timeoutMs >= 0)
-        {
-            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
-            if (elapsed > timeoutMs)
-                break;
-        }
-        std::this_thread::sleep_for(std::chrono::microseconds(1));
+        const int index = indices[i];
+        if (index < 0 || index >= params.size()) continue;
+        if (onlyIfChanged && params[index]->getValue() == values[i]) continue;
+
+        setParamNow(plugin.get(), params[index], index, values[i], now);
+        numSet++;
     }
+    return numSet;
 }
 
-void PluginHost::setForceSynchronous(bool b)
+void PluginHost::getParams(std::vector<float>& values, int stage)
 {
-    m_forceSynchronous = b;
+    values.clear();
+    auto plugin = getPlugin(stage);
+    if (!plugin) return;
+    auto& params = plugin->getParameters();
+    values.reserve((size_t)params.size());
+    for (auto* param : params)
+        values.push_back(param->getValue());
 }
 
-bool PluginHost::getForceSynchronous() const
+int PluginHost::setParams(Chuck_ArrayInt* indices, Chuck_ArrayFloat* values, bool onlyIfChanged, int stage)
 {
-    return m_forceSynchronous;
+    if (!indices || !values) return 0;
+    const int count = (int)std::min(m_api->object->array_int_size(indices), m_api->object->array_float_size(values));
+
+    m_batchIndices.resize((size_t)count);
+    m_batchValues.resize((size_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        m_batchIndices[(size_t)i] = (int)m_api->object->array_int_get_idx(indices, i);
+        m_batchValues[(size_t)i] = (float)m_api->object->array_float_get_idx(values, i);
+    }
+    return setParams(m_batchIndices.data(), m_batchValues.data(), count, onlyIfChanged, stage);
 }
 
-//-------------------------------------------------------------------------
-// processing config
-//-------------------------------------------------------------------------
-void PluginHost::setBlockSize(int size)
+int PluginHost::getParams(Chuck_ArrayFloat* values, int stage)
 {
-    if (size <= 0) return;
+    if (!values) return 0;
+    getParams(m_batchValues, stage);
 
-    callOnMainThread([this, size, context = createAsyncEventContext()]
-    {
-        juce::SpinLock::ScopedLockType lock(m_audioLock);
-        m_blockSize = std::min(size, maxBufferSize);
-        m_renderBuffer.setSize(maxChannels, m_blockSize);
+    m_api->object->array_float_clear(values);
+    for (float value : m_batchValues)
+        m_api->object->array_float_push_back(values, value);
+    return (int)m_batchValues.size();
+}
 
-        if (m_plugin)
-            m_plugin->prepareToPlay(m_srate, m_blockSize);
-    });
+int PluginHost::findParam(const std::string& name, int stage)
+{
+    auto table = getParameterTable(stage);
+    return table ? table->findByName(name) : -1;
 }
 
-int PluginHost::getBlockSize() const
+std::string PluginHost::getParamLabel(int index, int stage)
 {
-    return m_blockSize;
+    auto table = getParameterTable(stage);
+    auto* info = table ? table->get(index) : nullptr;
+    return info ? info->label : "";
 }
 
-int PluginHost::getLatency() const
+std::string PluginHost::getParamDisplay(int index, int stage)
 {
-    return m_plugin ? m_plugin->getLatencySamples() : 0;
+    auto plugin = getPlugin(stage);
+    if (!plugin) return "";
+    auto& params = plugin->getParameters();
+    if (index < 0 || index >= params.size()) return "";
+
+    // the text is only fetched from the plugin again once the value changed
+    auto changes = getParameterChanges(stage);
+    if (changes && index < changes->size())
+        return changes->getDisplay(*params[index], index);
+    return params[index]->getCurrentValueAsText().toStdString();
 }
 
-void PluginHost::setBypass(bool b)
+std::string PluginHost::getParamId(int index, int stage)
 {
-    if (m_plugin) m_plugin->suspendProcessing(b);
+    auto table = getParameterTable(stage);
+    auto* info = table ? table->get(index) : nullptr;
+    return info ? info->id : "";
 }
 
-bool PluginHost::getBypass() const
+int PluginHost::findParamById(const std::string& id, int stage)
 {
-    return m_plugin ? m_plugin->isSuspended() : false;
+    auto table = getParameterTable(stage);
+    return table ? table->findById(id) : -1;
 }
 
-void PluginHost::reset()
+int PluginHost::getNonMidiParam(int n, int stage)
 {
-    if (m_plugin) m_plugin->reset();
+    auto table = getParameterTable(stage);
+    if (!table) return -1;
+    auto& indices = table->getNonMidiParams();
+    if (n < 0 || n >= (int)indices.size()) return -1;
+    return indices[(size_t)n];
 }
 
-int PluginHost::getNumInputs() const
+float PluginHost::getParamDefault(int index, int stage)
 {
-    return m_plugin ? m_plugin->getTotalNumInputChannels() : 0;
+    auto table = getParameterTable(stage);
+    auto* info = table ? table->get(index) : nullptr;
+    return info ? info->defaultValue : 0.0f;
 }
 
-int PluginHost::getNumOutputs() const
+int PluginHost::getParamNumSteps(int index, int stage)
 {
-    return m_plugin ? m_plugin->getTotalNumOutputChannels() : 0;
+    auto table = getParameterTable(stage);
+    auto* info = table ? table->get(index) : nullptr;
+    return info ? info->numSteps : 0;
 }
 
-void PluginHost::setRealtime(bool b)
+//-------------------------------------------------------------------------
+// metadata
+//-------------------------------------------------------------------------
+std::string PluginHost::getName(int stage) const
 {
-    if (m_plugin) m_plugin->setNonRealtime(!b);
+    auto plugin = getPlugin(stage);
+    return plugin ? plugin->getName().toStdString() : "";
 }
 
-bool PluginHost::isRealtime() const
+std::string PluginHost::getVendor(int stage) const
 {
-    return m_plugin ? !m_plugin->isNonRealtime() : false;
+    auto plugin = getPlugin(stage);
+    return plugin ? plugin->getPluginDescription().manufacturerName.toStdString() : "";
 }
 
 //-------------------------------------------------------------------------
-// program functions
+// load / state
 //-------------------------------------------------------------------------
-int PluginHost::getNumPrograms()
+void PluginHost::loadPlugin(const std::string& path)
 {
-    if (!m_plugin) return 0;
-    return m_plugin->getNumPrograms();
+    loadPlugin(path, [this](Stage stage) { replaceChain(std::move(stage)); });
 }
 
-int PluginHost::getCurrentProgram()
+void PluginHost::replaceChain(Stage stage)
 {
-    if (!m_plugin) return 0;
-    return m_plugin->getCurrentProgram();
+    // the existing plugins are kept alive by the audio thread's config until the new one is published
+    m_stages.clear();
+    m_stages.push_back(std::move(stage));
+    m_connections.clear();
 }
 
-void PluginHost::setCurrentProgram(int index)
+void PluginHost::loadPlugin(const std::string& path, std::function<void(Stage)> install)
 {
-    if (!m_plugin) return;
-    if (index < 0 || index >= m_plugin->getNumPrograms()) return;
+    auto context = createAsyncEventContext();
+    juce::File file(path);
+    if (!file.exists())
+    {
+        context->fail("File does not exist: " + path);
+        return;
+    }
 
-    callOnMainThread([this, index, context = createAsyncEventContext()]
+    // moved into the step, waiting for the async events below would never return while we hold on to it
+    callOnMainThread([this, file, install, context = std::move(context)]
     {
-        m_plugin->setCurrentProgram(index);
-    });
-}
+        if (context->cancelled())
+            return;
 
-std::string PluginHost::getProgramName(int index)
-{
-    if (!m_plugin) return "";
-    if (index < 0 || index >= m_plugin->getNumPrograms()) return "";
-    return m_plugin->getProgramName(index).toStdString();
-}
+        // a preloaded instance is ready to go
+        const auto key = PluginPool::getKey(file.getFullPathName());
+        PluginPool::Instance preloaded;
+        if (m_pool->take(key, preloaded))
+        {
+            installPlugin(std::move(preloaded), key, install);
+            return;
+        }
 
-//-------------------------------------------------------------------------
+        juce::PluginDescription description;
+        if (!findPluginDescription(file, description, *context))
+            return;
+
+        createPluginInstance(description, context, [this, key, install](PluginPool::Instance instance)
+        {
+            installPlugin(std::move(instance), key, install);
+
+            constexpr bool displayEditor = false;
+            if (displayEditor)
+                showEditor();
+        });
+    });
+
+    // if we are forcing synchronicity, wait for the plugin to load
+    if (m_forceSynchronous)
+        waitForAsyncEvents();
+}
+
+bool PluginHost::findPluginDescription(const juce::File& file, juce::PluginDescription& description, AsyncEventContext& context)
+{
+    // only scanned if the catalog hasn't seen this version of the file before
+    juce::OwnedArray<juce::PluginDescription> descriptions;
+    if (!m_catalog->findPlugins(file, descriptions))
+    {
+        context.fail("No format found for file " + file.getFileName().toStdString());
+        return false;
+    }
+
+    if (descriptions.size() == 0)
+    {
+        context.fail("No plugin descriptions found in file.");
+        return false;
+    }
+
+    std::cout << "PluginHost: Found " << descriptions.size() << " plugin descriptions. Loading the first one..." << std::endl;
+    description = *descriptions[0];
+    return true;
+}
+
+void PluginHost::createPluginInstance(const juce::PluginDescription& description, std::shared_ptr<AsyncEventContext> context,
+                                      std::function<void(PluginPool::Instance)> done)
+{
+    const double sampleRate = m_srate;
+    const int maxBlockSize = m_maxBlockSize;
+    const auto callback = [this, done, sampleRate, maxBlockSize, context](std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String& error)
+    {
+        if (!instance)
+        {
+            context->fail("Failed to load plugin: " + error.toStdString());
+            return;
+        }
+
+        // the instance is dropped here, on the message thread
+        if (context->cancelled())
+            return;
+
+        // the layout has to be settled before preparing
+        configureBuses(*instance);
+
+        // prepare for the maximum block size so that block size changes don't need to re-prepare
+        instance->prepareToPlay(sampleRate, maxBlockSize);
+
+        // run a few blocks of silence here, so whatever the plugin sets up lazily on its first blocks
+        // isn't done on the audio thread
+        constexpr int warmUpBlocks = 4;
+        juce::AudioBuffer<float> silence(std::max(instance->getTotalNumInputChannels(), instance->getTotalNumOutputChannels()), maxBlockSize);
+        juce::MidiBuffer midi;
+        for (int i = 0; i < warmUpBlocks; i++)
+        {
+            silence.clear();
+            midi.clear();
+            instance->processBlock(silence, midi);
+        }
+        done({ std::move(instance), sampleRate, maxBlockSize });
+    };
+
+    // create the plugin instance asynchronously
+    m_catalog->getFormatManager().createPluginInstanceAsync(description, sampleRate, maxBlockSize, callback);
+}
+
+void PluginHost::installPlugin(PluginPool::Instance instance, const std::string& poolKey, const std::function<void(Stage)>& install)
+{
+    // a preloaded instance may have been prepared by a host with other settings
+    if (instance.sampleRate != m_srate || instance.maxBlockSize != m_maxBlockSize)
+        instance.plugin->prepareToPlay(m_srate, m_maxBlockSize);
+    instance.plugin->setPlayHead(&m_playHead);
+
+    std::cout << "PluginHost: Successfully loaded: " << instance.plugin->getName() << std::endl;
+
+    Stage stage;
+    stage.plugin = std::move(instance.plugin);
+    stage.poolKey = poolKey;
+    install(std::move(stage));
+    stagesChanged();
+}
+
+void PluginHost::preload(const std::string& path, int count)
+{
+    auto context = createAsyncEventContext();
+    juce::File file(path);
+    if (!file.exists())
+    {
+        context->fail("File does not exist: " + path);
+        return;
+    }
+
+    callOnMainThread([this, file, count, context = std::move(context)]
+    {
+        if (context->cancelled())
+            return;
+
+        juce::PluginDescription description;
+        if (!findPluginDescription(file, description, *context))
+            return;
+
+        for (int i = 0; i < count; i++)
+        {
+            createPluginInstance(description, context, [pool = m_pool, key = PluginPool::getKey(file.getFullPathName())](PluginPool::Instance instance)
+            {
+                pool->add(key, std::move(instance));
+            });
+        }
+    });
+
+    if (m_forceSynchronous)
+        waitForAsyncEvents();
+}
+
+int PluginHost::getNumPreloaded(const std::string& path) const
+{
+    return m_pool->getNumAvailable(PluginPool::getKey(path));
+}
+
+void PluginHost::clearPreloaded(const std::string& path)
+{
+    const auto key = path.empty() ? std::string() : PluginPool::getKey(path);
+    callOnMainThread([pool = m_pool, key] { pool->clear(key); });
+}
+
+void PluginHost::clonePlugin(PluginHost& source, Chuck_Object * sourceObject, int sourceStage)
+{
+    auto context = createAsyncEventContext();
+    // the source's stages belong to the message thread, so they're only looked at there, the reference
+    // keeps the source alive until then (and is let go of by the tick after the operation has finished)
+    if (sourceObject && &source != this)
+        holdObject(sourceObject, context->m_operation);
+
+    callOnMainThread([this, &source, sourceStage, context = std::move(context)]
+    {
+        if (context->cancelled())
+            return;
+
+        if (sourceStage < 0 || sourceStage >= (int)source.m_stages.size())
+        {
+            context->fail("Nothing to clone at stage " + std::to_string(sourceStage));
+            return;
+        }
+        const auto& stage = source.m_stages[(size_t)sourceStage];
+        auto plugin = stage.plugin;
+        // the key the source was loaded under, the same preloaded instances load() would take
+        const auto key = stage.poolKey;
+
+        juce::MemoryBlock state;
+        plugin->getStateInformation(state);
+        const auto description = plugin->getPluginDescription();
+
+        // the description is known already, no need to go through the catalog
+        const auto install = [this, state, key](PluginPool::Instance instance)
+        {
+            instance.plugin->setStateInformation(state.getData(), (int)state.getSize());
+            installPlugin(std::move(instance), key, [this](Stage s) { replaceChain(std::move(s)); });
+        };
+
+        PluginPool::Instance preloaded;
+        if (m_pool->take(key, preloaded))
+            install(std::move(preloaded));
+        else
+            createPluginInstance(description, context, install);
+    });
+
+    if (m_forceSynchronous)
+        waitForAsyncEvents();
+}
+
+void PluginHost::showEditor(int stage)
+{
+    queueCoalesced(CommandKind::editor, stage, 1, {}, createAsyncEventContext());
+}
+
+void PluginHost::hideEditor(int stage)
+{
+    queueCoalesced(CommandKind::editor, stage, 0, {}, createAsyncEventContext());
+}
+
+void PluginHost::openEditor(int stage)
+{
+    if (stage < 0 || stage >= (int)m_stages.size())
+        return;
+    auto& editorWindow = m_stages[(size_t)stage].editor;
+
+    // if the editor already exists, just bring it to the front
+    if (editorWindow)
+    {
+        editorWindow->toFront(true);
+        return;
+    }
+    
+    // make sure that there is a plugin and that the plugin has an editor
+    auto& plugin = m_stages[(size_t)stage].plugin;
+    if (!plugin->hasEditor())
+        return;
+    
+    // create the editor
+    if (auto* editor = plugin->createEditorIfNeeded())
+    {
+        ensureForegroundProcess();
+
+        // wrap the editor in a window
+        auto* window = new PluginEditorWindow(*this, editor);
+        window->addToDesktop();
+        window->toFront(true);
+        // stages may have moved by the time the window is closed
+        window->onClose = [this, window]()
+        {
+            for (auto& s : m_stages)
+            {
+                if (s.editor.get() == window)
+                    s.editor.reset();
+            }
+        };
+        editorWindow.reset(window);
+    }
+}
+
+void PluginHost::saveState(const std::string& path, int stage)
+{
+    callOnMainThread([this, path, stage, context = createAsyncEventContext()]
+    {
+        auto plugin = getPlugin(stage);
+        if (!plugin)
+        {
+            std::cout << "PluginHost: No plugin loaded." << std::endl;
+            return;
+        }
+
+        juce::MemoryBlock destData;
+        plugin->getStateInformation(destData);
+
+        juce::File file(path);
+        if (file.replaceWithData(destData.getData(), destData.getSize()))
+            std::cout << "PluginHost: State saved to " << path << std::endl;
+        else
+            std::cout << "PluginHost: Failed to save state to " << path << std::endl;
+    });
+}
+
+void PluginHost::loadState(const std::string& path, int stage)
+{
+    queueCoalesced(CommandKind::loadState, stage, 0, path, createAsyncEventContext());
+}
+
+//-------------------------------------------------------------------------
+// plugin chain
+//-------------------------------------------------------------------------
+int PluginHost::getNumStages() const
+{
+    return (int)getStageViews()->size();
+}
+
+void PluginHost::addStage(const std::string& path)
+{
+    loadPlugin(path, [this](Stage stage)
+    {
+        m_stages.push_back(std::move(stage));
+    });
+}
+
+void PluginHost::insertStage(int index, const std::string& path)
+{
+    loadPlugin(path, [this, index](Stage stage)
+    {
+        // the chain may have changed while loading
+        const int position = juce::jlimit(0, (int)m_stages.size(), index);
+        m_stages.insert(m_stages.begin() + position, std::move(stage));
+    });
+}
+
+void PluginHost::replaceStage(int index, const std::string& path)
+{
+    loadPlugin(path, [this, index](Stage stage)
+    {
+        if (index >= 0 && index < (int)m_stages.size())
+            m_stages[(size_t)index] = std::move(stage);
+        else
+            m_stages.push_back(std::move(stage));
+    });
+}
+
+void PluginHost::removeStage(int index)
+{
+    callOnMainThread([this, index, context = createAsyncEventContext()]
+    {
+        if (index < 0 || index >= (int)m_stages.size())
+        {
+            std::cout << "PluginHost: No stage " << index << " in the chain." << std::endl;
+            return;
+        }
+
+        // the audio thread's config keeps the plugin alive until the new chain is published
+        m_stages.erase(m_stages.begin() + index);
+        remapConnections([index](int n) { return n == index ? -1 : (n > index ? n - 1 : n); });
+        stagesChanged();
+    });
+}
+
+void PluginHost::moveStage(int from, int to)
+{
+    callOnMainThread([this, from, to, context = createAsyncEventContext()]
+    {
+        const int numStages = (int)m_stages.size();
+        if (from < 0 || from >= numStages || to < 0 || to >= numStages)
+        {
+            std::cout << "PluginHost: Can't move stage " << from << " to " << to << ", the chain has " << numStages << " stages." << std::endl;
+            return;
+        }
+        if (from == to)
+            return;
+
+        Stage stage = std::move(m_stages[(size_t)from]);
+        m_stages.erase(m_stages.begin() + from);
+        m_stages.insert(m_stages.begin() + to, std::move(stage));
+        remapConnections([from, to](int n)
+        {
+            if (n == from) return to;
+            if (from < to && n > from && n <= to) return n - 1;
+            if (to < from && n >= to && n < from) return n + 1;
+            return n;
+        });
+        stagesChanged();
+    });
+}
+
+int PluginHost::findStage(const juce::AudioProcessor* processor) const
+{
+    for (size_t i = 0; i < m_stages.size(); i++)
+    {
+        if (m_stages[i].plugin.get() == processor)
+            return (int)i;
+    }
+    return -1;
+}
+
+//-------------------------------------------------------------------------
+// plugin graph
+//-------------------------------------------------------------------------
+void PluginHost::enableGraph()
+{
+    m_graphMode = true;
+}
+
+void PluginHost::connect(int source, int destination, bool midi)
+{
+    callOnMainThread([this, source, destination, midi, context = createAsyncEventContext()]
+    {
+        const int numStages = (int)m_stages.size();
+        const bool validSource = source == PluginGraph::inputNode || (source >= 0 && source < numStages);
+        const bool validDestination = destination == PluginGraph::outputNode || (destination >= 0 && destination < numStages);
+        if (!validSource || !validDestination)
+        {
+            std::cout << "PluginHost: Can't connect " << source << " to " << destination << ", no such node." << std::endl;
+            return;
+        }
+
+        const PluginGraph::Connection connection { source, destination, midi };
+        if (std::find(m_connections.begin(), m_connections.end(), connection) != m_connections.end())
+            return;
+
+        if (PluginGraph::createsCycle(m_connections, connection))
+        {
+            std::cout << "PluginHost: Can't connect " << source << " to " << destination << ", it would create a feedback loop." << std::endl;
+            return;
+        }
+
+        m_connections.push_back(connection);
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+void PluginHost::disconnect(int source, int destination, bool midi)
+{
+    callOnMainThread([this, source, destination, midi, context = createAsyncEventContext()]
+    {
+        const PluginGraph::Connection connection { source, destination, midi };
+        auto it = std::find(m_connections.begin(), m_connections.end(), connection);
+        if (it == m_connections.end())
+            return;
+
+        m_connections.erase(it);
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+void PluginHost::disconnectAll()
+{
+    callOnMainThread([this, context = createAsyncEventContext()]
+    {
+        m_connections.clear();
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+//-------------------------------------------------------------------------
+// async / sync
+//-------------------------------------------------------------------------
+bool PluginHost::asyncEventRunning() const
+{
+    return m_asyncEventCount > 0;
+}
+
+void PluginHost::waitForAsyncEvents(int timeoutMs) const
+{
+    // sleeps until the last event is done, see asyncEventFinished()
+    std::unique_lock<std::mutex> lock(m_asyncEventMutex);
+    const auto finished = [this] { return m_asyncEventCount.load() == 0; };
+    if (timeoutMs >= 0)
+        m_asyncEventsDone.wait_for(lock, std::chrono::milliseconds(timeoutMs), finished);
+    else
+        m_asyncEventsDone.wait(lock, finished);
+}
+
+void PluginHost::asyncEventFinished()
+{
+    if (m_asyncEventCount.fetch_sub(1) == 1)
+    {
+        // taking the lock makes sure a waiter has either seen the count or is waiting already
+        std::lock_guard<std::mutex> lock(m_asyncEventMutex);
+        m_asyncEventsDone.notify_all();
+    }
+}
+
+void PluginHost::AsyncEventContext::fail(const std::string& error)
+{
+    std::cout << "PluginHost: " << error << std::endl;
+    m_operation->fail(error);
+}
+
+Chuck_Object * PluginHost::getOperationObject(std::shared_ptr<AsyncOperation> operation)
+{
+    // nothing started yet, hand out one which is done already
+    if (!operation)
+    {
+        operation = std::make_shared<AsyncOperation>();
+        operation->finish();
+    }
+
+    for (auto& entry : m_operationObjects)
+    {
+        if (entry.operation == operation)
+            return entry.object;
+    }
+
+    auto* opType = m_api->type->lookup(m_vm, "PluginOp");
+    auto* object = m_api->object->create_without_shred(m_vm, opType, true);
+    OBJ_MEMBER_INT(object, pluginop_data_offset) = (t_CKINT) new std::shared_ptr<AsyncOperation>(operation);
+    m_operationObjects.push_back({ std::move(operation), object, false });
+    return object;
+}
+
+void PluginHost::holdObject(Chuck_Object * object, std::shared_ptr<AsyncOperation> operation)
+{
+    m_api->object->add_ref(object);
+    m_heldObjects.push_back({ std::move(operation), object });
+}
+
+void PluginHost::updateOperationObjects()
+{
+    for (auto it = m_heldObjects.begin(); it != m_heldObjects.end();)
+    {
+        if (it->operation->isFinished())
+        {
+            m_api->object->release(it->object);
+            it = m_heldObjects.erase(it);
+            continue;
+        }
+        ++it;
+    }
+
+    for (auto it = m_operationObjects.begin(); it != m_operationObjects.end();)
+    {
+        // the VM has delivered the broadcast queued on an earlier tick, the shreds hold their own references
+        if (it->broadcast)
+        {
+            m_api->object->release(it->object);
+            it = m_operationObjects.erase(it);
+            continue;
+        }
+
+        if (it->operation->isFinished())
+        {
+            m_api->vm->queue_event(m_vm, (Chuck_Event *)it->object, 1, m_eventBuffer);
+            it->broadcast = true;
+        }
+        ++it;
+    }
+}
+
+void PluginHost::queueCoalesced(CommandKind kind, int stage, int value, const std::string& path,
+                                std::shared_ptr<AsyncEventContext> context)
+{
+    std::shared_ptr<AsyncEventContext> merged;
+    {
+        std::lock_guard<std::mutex> lock(m_coalesceMutex);
+        auto& last = m_lastCoalesced;
+        // only into the command queued last, anything in between would otherwise be reordered
+        if (last && !last->started && last->kind == kind && last->stage == stage
+            && m_lastCoalescedSerial == m_numQueuedCommands.load())
+        {
+            last->value = value;
+            last->path = path;
+            merged = std::exchange(last->context, std::move(context));
+        }
+    }
+
+    if (merged)
+    {
+        // the merged call never runs, its operation finishes as cancelled when merged is released
+        merged->m_operation->cancel();
+        merged->cancelled();
+        m_numMergedCommands++;
+        return;
+    }
+
+    auto command = std::allocate_shared<CoalescedCommand>(OperationPool::Allocator<CoalescedCommand>());
+    command->kind = kind;
+    command->stage = stage;
+    command->value = value;
+    command->path = path;
+    command->context = std::move(context);
+
+    callOnMainThread([this, command]
+    {
+        std::shared_ptr<AsyncEventContext> context;
+        int value;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(m_coalesceMutex);
+            command->started = true;
+            context = std::move(command->context);
+            value = command->value;
+            path = std::move(command->path);
+        }
+
+        if (context->cancelled())
+            return;
+        runCoalesced(command->kind, command->stage, value, path, *context);
+    });
+
+    // in synchronous mode the command has run already, so nothing merges into it
+    std::lock_guard<std::mutex> lock(m_coalesceMutex);
+    m_lastCoalesced = std::move(command);
+    m_lastCoalescedSerial = m_numQueuedCommands.load();
+}
+
+void PluginHost::runCoalesced(CommandKind kind, int stage, int value, const std::string& path, AsyncEventContext& context)
+{
+    switch (kind)
+    {
+    case CommandKind::program:
+        if (auto plugin = getPlugin(stage))
+            plugin->setCurrentProgram(value);
+        break;
+
+    case CommandKind::blockSize:
+        // the plugin is already prepared for the max block size, so only a new render buffer is needed
+        m_blockSize = value;
+        publishConfig(createConfig(getStagePlugins()));
+        break;
+
+    case CommandKind::editor:
+        if (value)
+            openEditor(stage);
+        else if (stage >= 0 && stage < (int)m_stages.size())
+            m_stages[(size_t)stage].editor.reset();
+        break;
+
+    case CommandKind::loadState:
+    {
+        auto plugin = getPlugin(stage);
+        if (!plugin)
+        {
+            context.fail("No plugin loaded.");
+            return;
+        }
+
+        juce::File file(path);
+        if (!file.existsAsFile())
+        {
+            context.fail("File does not exist: " + path);
+            return;
+        }
+
+        juce::MemoryBlock destData;
+        if (file.loadFileAsData(destData))
+        {
+            plugin->setStateInformation(destData.getData(), (int)destData.getSize());
+            std::cout << "PluginHost: State loaded from " << path << std::endl;
+        }
+        else
+            context.fail("Failed to load state from " + path);
+        break;
+    }
+    }
+}
+
+void PluginHost::setForceSynchronous(bool b)
+{
+    m_forceSynchronous = b;
+}
+
+bool PluginHost::getForceSynchronous() const
+{
+    return m_forceSynchronous;
+}
+
+//-------------------------------------------------------------------------
+// processing config
+//-------------------------------------------------------------------------
+void PluginHost::setBlockSize(int size)
+{
+    auto context = createAsyncEventContext();
+    if (size <= 0)
+    {
+        context->fail("Invalid block size " + std::to_string(size));
+        return;
+    }
+
+    queueCoalesced(CommandKind::blockSize, 0, size, {}, std::move(context));
+}
+
+int PluginHost::getBlockSize() const
+{
+    // the block size can't exceed what the plugin is prepared for
+    return std::min(m_blockSize.load(), m_maxBlockSize.load());
+}
+
+void PluginHost::setMaxBlockSize(int size)
+{
+    auto context = createAsyncEventContext();
+    if (size <= 0)
+    {
+        context->fail("Invalid max block size " + std::to_string(size));
+        return;
+    }
+
+    callOnMainThread([this, size, context = std::move(context)]
+    {
+        m_maxBlockSize = std::min(size, maxBlockSizeLimit);
+
+        // loaded plugins have to be re-prepared, which can't happen while the audio thread is using them
+        if (!m_stages.empty())
+        {
+            runWithPluginDetached([this]
+            {
+                for (auto& stage : m_stages)
+                {
+                    stage.plugin->releaseResources();
+                    stage.plugin->prepareToPlay(m_srate, m_maxBlockSize);
+                }
+            });
+        }
+        else
+            publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+int PluginHost::getMaxBlockSize() const
+{
+    return m_maxBlockSize.load();
+}
+
+void PluginHost::setDirectProcessing(bool b)
+{
+    callOnMainThread([this, b, context = createAsyncEventContext()]
+    {
+        m_directProcessing = b;
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+bool PluginHost::getDirectProcessing() const
+{
+    return m_directProcessing.load();
+}
+
+void PluginHost::rampParam(int index, float target, double length, bool exponential, int stage, bool append)
+{
+    ParameterQueue::Change change;
+    change.type = exponential ? ParameterQueue::Change::exponential : ParameterQueue::Change::linear;
+    change.index = index;
+    change.value = juce::jlimit(0.0f, 1.0f, target);
+    change.length = std::max(0.0, length);
+    change.append = append;
+    queueAutomation(change, stage);
+}
+
+void PluginHost::setParamLFO(int index, int shape, float frequency, float center, float depth, int stage)
+{
+    ParameterQueue::Change change;
+    change.type = ParameterQueue::Change::lfo;
+    change.index = index;
+    change.value = center;
+    change.depth = depth;
+    change.shape = shape;
+    change.frequency = frequency / m_srate;
+    queueAutomation(change, stage);
+}
+
+void PluginHost::stopParamAutomation(int index, int stage)
+{
+    ParameterQueue::Change change;
+    change.type = ParameterQueue::Change::stop;
+    change.index = index;
+    queueAutomation(change, stage);
+}
+
+void PluginHost::setModulation(int input, int index, float center, float depth, int stage)
+{
+    if (input < 0 || input >= maxModInputs) return;
+
+    callOnMainThread([this, input, index, center, depth, stage, context = createAsyncEventContext()]
+    {
+        if (stage < 0 || stage >= (int)m_stages.size()) return;
+        auto& plugin = m_stages[(size_t)stage].plugin;
+        if (index < 0 || index >= plugin->getParameters().size()) return;
+
+        // an input drives one parameter
+        m_modMappings.erase(std::remove_if(m_modMappings.begin(), m_modMappings.end(),
+            [input](const ModMapping& mapping) { return mapping.input == input; }), m_modMappings.end());
+        m_modMappings.push_back({ input, plugin, index, center, depth });
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+void PluginHost::clearModulation(int input)
+{
+    callOnMainThread([this, input, context = createAsyncEventContext()]
+    {
+        m_modMappings.erase(std::remove_if(m_modMappings.begin(), m_modMappings.end(),
+            [input](const ModMapping& mapping) { return input < 0 || mapping.input == input; }), m_modMappings.end());
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+void PluginHost::setModulationInput(ModulationInput * input, Chuck_Object * object)
+{
+    if (object)
+        m_api->object->add_ref(object);
+    if (m_modInputObject)
+        m_api->object->release(m_modInputObject);
+
+    // read by tick(), which runs on the VM thread as well
+    m_modInput = input;
+    m_modInputObject = object;
+}
+
+void PluginHost::queueAutomation(ParameterQueue::Change change, int stage)
+{
+    auto plugin = getPlugin(stage);
+    if (!plugin) return;
+    if (change.index >= plugin->getParameters().size()) return;
+
+    // automation is run by the audio thread, without ticks it would only pile up in the queue
+    const int64_t now = getNow();
+    if (now > m_tickEndTime)
+    {
+        std::cout << "PluginHost: not being ticked (connect the host to dac or blackhole), automation dropped" << std::endl;
+        return;
+    }
+
+    change.plugin = plugin.get();
+    change.time = now;
+    if (!m_parameterQueue.push(change))
+        std::cout << "PluginHost: too many pending parameter changes, automation dropped" << std::endl;
+}
+
+void PluginHost::setMinSubBlockSize(int size)
+{
+    // read by the audio thread on every block, no new config needed
+    m_minSubBlockSize = juce::jlimit(1, maxBlockSizeLimit, size);
+}
+
+int PluginHost::getMinSubBlockSize() const
+{
+    return m_minSubBlockSize.load();
+}
+
+void PluginHost::setCrossfade(double samples)
+{
+    // read by the audio thread whenever it picks up new plugins
+    m_crossfade = (int)juce::jlimit(0.0, maxCrossfadeSeconds * m_srate, samples);
+}
+
+double PluginHost::getCrossfade() const
+{
+    return (double)m_crossfade.load();
+}
+
+void PluginHost::setAsync(bool b)
+{
+    if (b && m_graphMode.load())
+    {
+        // a graph already spreads its branches over the worker pool, see createConfig()
+        std::cout << "PluginHost: async / parallel processing isn't available for a PluginGraph." << std::endl;
+        return;
+    }
+
+    callOnMainThread([this, b, context = createAsyncEventContext()]
+    {
+        m_async = b;
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+bool PluginHost::getAsync() const
+{
+    return m_async.load();
+}
+
+void PluginHost::setParallel(bool b)
+{
+    if (b && m_graphMode.load())
+    {
+        // a graph already spreads its branches over the worker pool, see createConfig()
+        std::cout << "PluginHost: async / parallel processing isn't available for a PluginGraph." << std::endl;
+        return;
+    }
+
+    callOnMainThread([this, b, context = createAsyncEventContext()]
+    {
+        m_parallel = b;
+        publishConfig(createConfig(getStagePlugins()));
+    });
+}
+
+bool PluginHost::getParallel() const
+{
+    return m_parallel.load();
+}
+
+void PluginHost::setNumWorkers(int num)
+{
+    // the count is visible right away, starting and stopping the threads is left to the message thread
+    ParallelScheduler::setDefaultNumWorkers(num);
+    callOnMessageThread([] { ParallelScheduler::applyDefaultNumWorkers(); });
+}
+
+int PluginHost::getNumWorkers()
+{
+    return ParallelScheduler::getDefaultNumWorkers();
+}
+
+//-------------------------------------------------------------------------
+// plugin discovery
+//-------------------------------------------------------------------------
+// matches of the last search (VM thread)
+static std::vector<juce::PluginDescription>& getSearchResults()
+{
+    static std::vector<juce::PluginDescription> results;
+    return results;
+}
+
+static const juce::PluginDescription* getSearchResult(int index)
+{
+    auto& results = getSearchResults();
+    return index >= 0 && index < (int)results.size() ? &results[(size_t)index] : nullptr;
+}
+
+void PluginHost::scanPlugins(const std::string& directory)
+{
+    callOnMessageThread([directory]
+    {
+        juce::StringArray directories;
+        if (!directory.empty())
+            directories.add(directory);
+        if (!PluginScanner::start(directories) && PluginScanner::isScanning())
+            std::cout << "PluginHost: A plugin scan is already running" << std::endl;
+    });
+}
+
+bool PluginHost::isScanningPlugins()
+{
+    return PluginScanner::isScanning();
+}
+
+int PluginHost::searchPlugins(const std::string& query)
+{
+    getSearchResults() = PluginCatalog::getShared()->search(juce::String(query));
+    return (int)getSearchResults().size();
+}
+
+std::string PluginHost::getFoundPluginPath(int index)
+{
+    auto* result = getSearchResult(index);
+    return result ? result->fileOrIdentifier.toStdString() : "";
+}
+
+std::string PluginHost::getFoundPluginName(int index)
+{
+    auto* result = getSearchResult(index);
+    return result ? result->name.toStdString() : "";
+}
+
+std::string PluginHost::getFoundPluginVendor(int index)
+{
+    auto* result = getSearchResult(index);
+    return result ? result->manufacturerName.toStdString() : "";
+}
+
+std::string PluginHost::getFoundPluginCategory(int index)
+{
+    auto* result = getSearchResult(index);
+    return result ? result->category.toStdString() : "";
+}
+
+void PluginHost::clearPluginCache()
+{
+    callOnMessageThread([catalog = PluginCatalog::getShared()] { catalog->clear(); });
+}
+
+int PluginHost::getLatency() const
+{
+    return m_latency.load();
+}
+
+int PluginHost::getTotalLatency() const
+{
+    return m_totalLatency.load();
+}
+
+void PluginHost::setBypass(bool b, int stage)
+{
+    if (auto plugin = getPlugin(stage)) plugin->suspendProcessing(b);
+}
+
+bool PluginHost::getBypass(int stage) const
+{
+    auto plugin = getPlugin(stage);
+    return plugin ? plugin->isSuspended() : false;
+}
+
+void PluginHost::reset()
+{
+    for (auto& stage : *getStageViews())
+        stage.plugin->reset();
+}
+
+int PluginHost::getNumInputs() const
+{
+    return m_numInputChannels.load();
+}
+
+int PluginHost::getNumOutputs() const
+{
+    return m_numOutputChannels.load();
+}
+
+void PluginHost::setRealtime(bool b)
+{
+    for (auto& stage : *getStageViews())
+        stage.plugin->setNonRealtime(!b);
+}
+
+bool PluginHost::isRealtime() const
+{
+    auto plugin = getPlugin(0);
+    return plugin ? !plugin->isNonRealtime() : false;
+}
+
+//-------------------------------------------------------------------------
+// program functions
+//-------------------------------------------------------------------------
+int PluginHost::getNumPrograms(int stage)
+{
+    auto plugin = getPlugin(stage);
+    if (!plugin) return 0;
+    return plugin->getNumPrograms();
+}
+
+int PluginHost::getCurrentProgram(int stage)
+{
+    auto plugin = getPlugin(stage);
+    if (!plugin) return 0;
+    return plugin->getCurrentProgram();
+}
+
+void PluginHost::setCurrentProgram(int index, int stage)
+{
+    auto context = createAsyncEventContext();
+    auto plugin = getPlugin(stage);
+    if (!plugin)
+    {
+        context->fail("No plugin loaded.");
+        return;
+    }
+    if (index < 0 || index >= plugin->getNumPrograms())
+    {
+        context->fail("Invalid program index " + std::to_string(index));
+        return;
+    }
+
+    queueCoalesced(CommandKind::program, stage, index, {}, std::move(context));
+}
+
+std::string PluginHost::getProgramName(int index, int stage)
+{
+    auto plugin = getPlugin(stage);
+    if (!plugin) return "";
+    if (index < 0 || index >= plugin->getNumPrograms()) return "";
+    return plugin->getProgramName(index).toStdString();
+}
+
+//-------------------------------------------------------------------------
 // playHead accessors
 //-------------------------------------------------------------------------
 float PluginHost::setBpm(float b) { m_playHead.setBpm(b); return b; }
@@ -758,9 +2042,90 @@ void PluginHost::midiMsg(int byte1, int byte2, int byte3)
 
 void PluginHost::addMidiEvent(const juce::MidiMessage& msg)
 {
-    int timestamp = m_inputBuffer.getAvailableSamples();
-    timestamp = std::max(0, std::min(m_blockSize - 1, timestamp));
-    m_inputMidi.addEvent(msg, timestamp);
+    // stamped with the sample the shred sent it at, tick() places it in the block covering that sample
+    // (if the queue is full the message is dropped rather than blocking the shred)
+    m_midiQueue.push(getNow(), msg.getRawData(), msg.getRawDataSize());
+}
+
+//-------------------------------------------------------------------------
+// MIDI output
+//-------------------------------------------------------------------------
+Chuck_Event * PluginHost::getMidiOutEvent()
+{
+    if (!m_midiOutEvent)
+    {
+        auto* eventType = m_api->type->lookup(m_vm, "Event");
+        m_midiOutEvent = (Chuck_Event *)m_api->object->create_without_shred(m_vm, eventType, true);
+    }
+    m_midiOutEnabled = true;
+    return m_midiOutEvent;
+}
+
+bool PluginHost::recvMidiOut()
+{
+    return m_midiOutQueue.pop(m_midiOutMessage);
+}
+
+int PluginHost::getMidiOutData(int index) const
+{
+    return index >= 0 && index < m_midiOutMessage.size ? m_midiOutMessage.data[index] : 0;
+}
+
+int64_t PluginHost::getMidiOutTime() const
+{
+    return m_midiOutMessage.time;
+}
+
+void PluginHost::setMidiForward(PluginHost * target, Chuck_Object * object)
+{
+    // forwarding to ourselves would feed the output back in
+    if (target == this)
+    {
+        std::cout << "PluginHost: can't forward MIDI to itself" << std::endl;
+        return;
+    }
+
+    if (object)
+        m_api->object->add_ref(object);
+    if (m_midiForwardObject)
+        m_api->object->release(m_midiForwardObject);
+
+    m_midiForward = target;
+    m_midiForwardObject = object;
+}
+
+//-------------------------------------------------------------------------
+// parameter change notifications
+//-------------------------------------------------------------------------
+Chuck_Event * PluginHost::getParamChangedEvent()
+{
+    if (!m_paramChangedEvent)
+    {
+        auto* eventType = m_api->type->lookup(m_vm, "Event");
+        m_paramChangedEvent = (Chuck_Event *)m_api->object->create_without_shred(m_vm, eventType, true);
+    }
+    m_paramChangedEnabled = true;
+    return m_paramChangedEvent;
+}
+
+bool PluginHost::recvParamChange()
+{
+    auto stages = getStageViews();
+    for (int stage = 0; stage < (int)stages->size(); stage++)
+    {
+        auto& changes = (*stages)[(size_t)stage].changes;
+        if (changes && changes->pop(m_paramChange.index, m_paramChange.value))
+        {
+            m_paramChange.stage = stage;
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t PluginHost::getNow() const
+{
+    return (int64_t)m_api->vm->now(m_vm);
 }
 
 void PluginHost::addQWERTYMidiInput()
@@ -794,9 +2159,361 @@ void PluginHost::toggleQWERTYMidiInput()
         addQWERTYMidiInput();
 }
 
+std::unique_ptr<PluginHost::ProcessingConfig> PluginHost::createConfig(PluginList plugins)
+{
+    const int maxBlockSize = m_maxBlockSize.load();
+    const int blockSize = std::min(m_blockSize.load(), maxBlockSize);
+
+    // without a plugin all channels are passed through
+    int numChannels = maxChannels;
+    int numRenderChannels = maxChannels;
+    if (!plugins.empty())
+    {
+        // the whole chain shares one render buffer, wide enough for its widest stage
+        numRenderChannels = 0;
+        for (auto& plugin : plugins)
+            numRenderChannels = std::max({ numRenderChannels, plugin->getTotalNumInputChannels(), plugin->getTotalNumOutputChannels() });
+        numChannels = std::min(numRenderChannels, maxChannels);
+    }
+
+    auto config = std::make_unique<ProcessingConfig>(numChannels, numRenderChannels, blockSize, maxBlockSize, m_directProcessing.load());
+    config->plugins = std::move(plugins);
+
+    // graphs are compiled here, off the audio thread, and swapped in with the rest of the config
+    if (m_graphMode.load() && !config->plugins.empty())
+        config->graph = std::make_unique<PluginGraph>(config->plugins, m_connections, maxBlockSize, ParallelScheduler::getShared());
+
+    // the worker needs fixed size blocks to stay exactly one block behind, so direct processing runs inline
+    const bool parallel = m_parallel.load();
+    if (!m_async.load() && !parallel)
+    {
+        // configs still using the worker keep it alive until they are reclaimed
+        m_asyncProcessor.reset();
+    }
+    else if (!config->plugins.empty() && !config->directProcessing && !config->graph)
+    {
+        // parallel processing shares the chugin-wide pool, async gets a thread of its own
+        auto scheduler = parallel ? ParallelScheduler::getShared() : nullptr;
+        if (!m_asyncProcessor || !m_asyncProcessor->canProcess(numRenderChannels, maxBlockSize, scheduler.get()))
+        {
+            m_asyncProcessor = std::make_shared<AsyncProcessor>(numRenderChannels, maxBlockSize, m_srate, scheduler);
+            m_asyncProcessors.push_back(m_asyncProcessor);
+        }
+        config->asyncProcessor = m_asyncProcessor;
+    }
+
+    // modulation inputs of plugins still in the chain
+    for (auto& mapping : m_modMappings)
+    {
+        auto plugin = mapping.plugin.lock();
+        if (!plugin || std::find(config->plugins.begin(), config->plugins.end(), plugin) == config->plugins.end())
+            continue;
+        auto& params = plugin->getParameters();
+        if (mapping.index < params.size())
+            config->modTargets.push_back({ mapping.input, params[mapping.index], mapping.center, mapping.depth });
+    }
+
+    // a graph compensates its branches up to the longest path, a chain's stages add up
+    int latency = 0;
+    if (config->graph)
+        latency = config->graph->getLatency();
+    else
+    {
+        for (auto& plugin : config->plugins)
+            latency += plugin->getLatencySamples();
+    }
+    m_latency = latency;
+
+    // accumulating blocks delays by blockSize - 1 samples, the async worker by another block
+    int hostLatency = config->directProcessing ? 0 : blockSize - 1;
+    if (config->asyncProcessor)
+        hostLatency += blockSize;
+    m_totalLatency = latency + hostLatency;
+
+    return config;
+}
+
+void PluginHost::publishConfig(std::unique_ptr<ProcessingConfig> config)
+{
+    // make room for the config the audio thread is about to retire
+    reclaimConfigs();
+
+    // a config that was replaced before the audio thread saw it can be deleted right away
+    std::unique_ptr<ProcessingConfig> stale(m_pendingConfig.exchange(config.release()));
+}
+
+void PluginHost::runWithPluginDetached(const std::function<void()>& func)
+{
+    // publish a config without the plugin (passthrough), then wait until the audio thread has either
+    // picked it up or is outside of tick() - the next tick is then guaranteed to pick it up.
+    // If the audio thread is blocked waiting for us (forceSynchronous) it is outside of tick() already.
+    publishConfig(createConfig({}));
+    for (;;)
+    {
+        // keep the retired slot empty, otherwise the audio thread would hold on to its current config
+        reclaimConfigs();
+        if (m_pendingConfig.load() == nullptr || !m_audioThreadProcessing.load())
+            break;
+        std::this_thread::yield();
+    }
+
+    // a worker may still be finishing the last block it was handed
+    waitForAsyncProcessors();
+
+    func();
+
+    publishConfig(createConfig(getStagePlugins()));
+}
+
+void PluginHost::reclaimConfigs()
+{
+    for (auto& slot : m_retiredConfigs)
+        std::unique_ptr<ProcessingConfig> retired(slot.exchange(nullptr));
+}
+
+bool PluginHost::retireConfig(ProcessingConfig* config)
+{
+    for (auto& slot : m_retiredConfigs)
+    {
+        if (slot.load() == nullptr)
+        {
+            slot.store(config);
+            return true;
+        }
+    }
+    return false;
+}
+
+int PluginHost::getNumFreeRetiredSlots() const
+{
+    int numFree = 0;
+    for (auto& slot : m_retiredConfigs)
+    {
+        if (slot.load() == nullptr)
+            numFree++;
+    }
+    return numFree;
+}
+
+void PluginHost::waitForAsyncProcessors()
+{
+    for (auto it = m_asyncProcessors.begin(); it != m_asyncProcessors.end();)
+    {
+        if (auto processor = it->lock())
+        {
+            processor->waitUntilIdle();
+            ++it;
+        }
+        else
+            it = m_asyncProcessors.erase(it);
+    }
+}
+
+PluginHost::ProcessingConfig& PluginHost::acquireConfig()
+{
+    // a finished crossfade is done with the old plugins (if there's no room yet, try again next tick)
+    if (m_fadeConfig && m_fadePosition >= m_fadeLength && retireConfig(m_fadeConfig))
+        m_fadeConfig = nullptr;
+
+    // A config with an async worker is retired as soon as it's replaced (it never crossfades) and may be deleted
+    // along with its plugins right away, so it's only swapped while the worker isn't running a block.
+    const bool workerIdle = !m_audioConfig->asyncProcessor || m_audioConfig->asyncProcessor->isIdle();
+
+    // only swap once there's room for the configs being replaced, the audio thread never deletes
+    if (workerIdle && getNumFreeRetiredSlots() >= (m_fadeConfig ? 2 : 1))
+    {
+        if (auto* next = m_pendingConfig.exchange(nullptr))
+        {
+            // carry over the accumulated audio so that a reconfiguration doesn't drop samples
+            next->inputBuffer.transferFrom(m_audioConfig->inputBuffer);
+            next->outputBuffer.transferFrom(m_audioConfig->outputBuffer);
+
+            // the modulation frames have to stay in step with the audio frames they arrived with,
+            // frames the old config didn't collect (it had no modulation) are silent
+            if (!next->modTargets.empty())
+            {
+                next->modInputBuffer.transferFrom(m_audioConfig->modInputBuffer);
+                const int missing = next->inputBuffer.getAvailableSamples() - next->modInputBuffer.getAvailableSamples();
+                if (missing > 0)
+                    next->modInputBuffer.pushSilence(missing);
+            }
+
+            // a crossfade still running is cut short
+            if (m_fadeConfig)
+            {
+                retireConfig(m_fadeConfig);
+                m_fadeConfig = nullptr;
+            }
+
+            const int crossfade = m_crossfade.load();
+            if (crossfade > 0 && canCrossfade(*m_audioConfig, *next))
+            {
+                m_fadeConfig = m_audioConfig;
+                m_fadePosition = 0;
+                m_fadeLength = crossfade;
+            }
+            else
+            {
+                retireConfig(m_audioConfig);
+            }
+            m_audioConfig = next;
+        }
+    }
+    return *m_audioConfig;
+}
+
+bool PluginHost::canCrossfade(const ProcessingConfig& old, const ProcessingConfig& next)
+{
+    // Only fade when the plugins were replaced - a plugin can't run in both configs at once, so
+    // rebuilds of the same chain (settings, latency, stages added around it) swap immediately.
+    // Unloading swaps immediately as well, runWithPluginDetached() relies on it.
+    if (next.plugins.empty())
+        return false;
+    for (auto& plugin : next.plugins)
+    {
+        if (std::find(old.plugins.begin(), old.plugins.end(), plugin) != old.plugins.end())
+            return false;
+    }
+
+    // the old config is run inline on the blocks of the new one
+    return !old.asyncProcessor && old.renderBuffer.getNumSamples() >= next.renderBuffer.getNumSamples();
+}
+
+void PluginHost::configureBuses(juce::AudioPluginInstance& instance)
+{
+    // request a stereo main bus on each side the plugin has, keep its other buses as they are
+    auto layout = instance.getBusesLayout();
+    if (!layout.inputBuses.isEmpty())
+        layout.inputBuses.getReference(0) = juce::AudioChannelSet::stereo();
+    if (!layout.outputBuses.isEmpty())
+        layout.outputBuses.getReference(0) = juce::AudioChannelSet::stereo();
+
+    if (instance.checkBusesLayoutSupported(layout))
+        instance.setBusesLayout(layout);
+    else
+    {
+        // the plugin doesn't like the normal layout, stick with its default
+    }
+
+    // checked once here rather than every block - extra channels are fed silence / dropped
+    if (std::max(instance.getTotalNumInputChannels(), instance.getTotalNumOutputChannels()) > maxChannels)
+        std::cout << "PluginHost: Plugin uses more than " << maxChannels << " channels, the extra channels will be silent." << std::endl;
+}
+
+std::shared_ptr<const PluginHost::StageViews> PluginHost::getStageViews() const
+{
+    return std::atomic_load(&m_publishedStages);
+}
+
+std::shared_ptr<juce::AudioPluginInstance> PluginHost::getPlugin(int stage) const
+{
+    auto stages = getStageViews();
+    if (stage < 0 || stage >= (int)stages->size())
+        return nullptr;
+    return (*stages)[(size_t)stage].plugin;
+}
+
+std::shared_ptr<const ParameterTable> PluginHost::getParameterTable(int stage) const
+{
+    auto stages = getStageViews();
+    if (stage < 0 || stage >= (int)stages->size())
+        return nullptr;
+    return (*stages)[(size_t)stage].params;
+}
+
+std::shared_ptr<ParameterChanges> PluginHost::getParameterChanges(int stage) const
+{
+    auto stages = getStageViews();
+    if (stage < 0 || stage >= (int)stages->size())
+        return nullptr;
+    return (*stages)[(size_t)stage].changes;
+}
+
+void PluginHost::publishStages()
+{
+    auto stages = std::make_shared<StageViews>();
+    stages->reserve(m_stages.size());
+    for (auto& stage : m_stages)
+        stages->push_back({ stage.plugin, stage.params, stage.changes });
+    std::atomic_store(&m_publishedStages, std::shared_ptr<const StageViews>(std::move(stages)));
+}
+
+PluginList PluginHost::getStagePlugins() const
+{
+    PluginList plugins;
+    plugins.reserve(m_stages.size());
+    for (auto& stage : m_stages)
+        plugins.push_back(stage.plugin);
+    return plugins;
+}
+
+void PluginHost::remapConnections(const std::function<int(int)>& map)
+{
+    std::vector<PluginGraph::Connection> connections;
+    for (auto connection : m_connections)
+    {
+        // the graph's own input and output (negative ids) are left as they are
+        const int source = connection.source < 0 ? connection.source : map(connection.source);
+        const int destination = connection.destination < 0 ? connection.destination : map(connection.destination);
+
+        // drop connections to / from a removed stage
+        if ((connection.source >= 0 && source < 0) || (connection.destination >= 0 && destination < 0))
+            continue;
+
+        connection.source = source;
+        connection.destination = destination;
+        connections.push_back(connection);
+    }
+    m_connections = std::move(connections);
+}
+
+void PluginHost::stagesChanged()
+{
+    // ChucK feeds the first stage and listens to the last one
+    m_numInputChannels = m_stages.empty() ? 0 : m_stages.front().plugin->getTotalNumInputChannels();
+    m_numOutputChannels = m_stages.empty() ? 0 : m_stages.back().plugin->getTotalNumOutputChannels();
+
+    updateParameterTables(false);
+    updatePluginListeners();
+    publishConfig(createConfig(getStagePlugins()));
+}
+
+void PluginHost::updateParameterTables(bool rebuildAll)
+{
+    // reading the metadata converts every parameter's name, so a stage keeps its table until its plugin says otherwise
+    for (auto& stage : m_stages)
+    {
+        if (rebuildAll || !stage.params)
+        {
+            stage.params = std::make_shared<ParameterTable>(*stage.plugin);
+            stage.changes = std::make_shared<ParameterChanges>(stage.plugin, m_paramsChanged);
+        }
+    }
+    publishStages();
+}
+
+void PluginHost::updatePluginListeners()
+{
+    for (auto& weak : m_listenedPlugins)
+    {
+        if (auto plugin = weak.lock())
+            plugin->removeListener(&m_pluginListener);
+    }
+    m_listenedPlugins.clear();
+
+    for (auto& stage : m_stages)
+    {
+        stage.plugin->addListener(&m_pluginListener);
+        m_listenedPlugins.push_back(stage.plugin);
+    }
+}
+
 std::shared_ptr<PluginHost::AsyncEventContext> PluginHost::createAsyncEventContext()
 {
-    return std::make_shared<AsyncEventContext>(*this);
+    // operations are started from the VM thread, so the last one can be handed to the shreds
+    // both from the operation pool, starting an operation doesn't allocate
+    m_lastOperation = std::allocate_shared<AsyncOperation>(OperationPool::Allocator<AsyncOperation>());
+    return std::allocate_shared<AsyncEventContext>(OperationPool::Allocator<AsyncEventContext>(), *this, m_lastOperation);
 }
 
 void PluginHost::ensureForegroundProcess()
@@ -813,20 +2530,18 @@ void PluginHost::ensureForegroundProcess()
 #endif
 }
 
-void PluginHost::callOnMainThread(std::function<void()> func)
-{
-    if (m_forceSynchronous)
-        callOnMessageThreadSync(func);
-    else
-        callOnMessageThread(func);
-}
-
 
 //-----------------------------------------------------------------------------
 // Main Thread Hook
 //-----------------------------------------------------------------------------
 t_CKBOOL CK_DLL_CALL pluginhost_main_hook( void * bindle )
 {
+#if PLUGINHOST_OWN_MESSAGE_THREAD
+    // the message loop runs on a thread of its own and wakes up when there's something to do,
+    // there's nothing to pump here
+    MessageThread::start();
+    juce::Thread::sleep(10);
+#else
     static bool juceInitialized = false;
     if(!juceInitialized)
     {
@@ -849,6 +2564,7 @@ t_CKBOOL CK_DLL_CALL pluginhost_main_hook( void * bindle )
 #else
     std::static_assert<false>; // this doesn't work
     juce::MessageManager::getInstance()->runDispatchLoop();
+#endif
 #endif
 
     return TRUE;
@@ -856,10 +2572,24 @@ t_CKBOOL CK_DLL_CALL pluginhost_main_hook( void * bindle )
 
 t_CKBOOL CK_DLL_CALL pluginhost_main_quit( void * bindle )
 {
+#if PLUGINHOST_OWN_MESSAGE_THREAD
+    if (MessageThread::isRunning())
+    {
+        // a running plugin scan would outlive JUCE otherwise
+        callOnMessageThreadSync([] { PluginScanner::shutdown(); });
+
+        // shuts JUCE down on the message thread once the queued work is done
+        MessageThread::stop();
+    }
+#else
     juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
 
+    // a running plugin scan would outlive JUCE otherwise
+    PluginScanner::shutdown();
+
     // clean up JUCE Message Manager
     juce::shutdownJuce_GUI();
+#endif
     return TRUE;
 }
 
@@ -871,6 +2601,62 @@ CK_DLL_QUERY( PluginHost )
 {
     QUERY->setname(QUERY, "PluginHost");
 
+    //-------------------------------------------------------------------------
+    // PluginOp
+    // handed out for operations running on the message thread, declared first as PluginHost returns it
+    //-------------------------------------------------------------------------
+    QUERY->begin_class(QUERY, "PluginOp", "Event");
+    QUERY->doc_class(QUERY, "An operation a PluginHost runs in the background, like load() or loadState(). Broadcast once it has finished (even if that was before anyone waited, as long as the host is connected), so a shred can sleep until then with plugin.load(path) => now. Check done() first when waiting on an operation started a while ago.");
+
+    QUERY->add_dtor(QUERY, pluginop_dtor);
+
+    QUERY->add_svar(QUERY, "int", "PENDING", TRUE, &pluginop_pending);
+    QUERY->doc_var(QUERY, "Status of an operation which is still running.");
+    QUERY->add_svar(QUERY, "int", "DONE", TRUE, &pluginop_done_status);
+    QUERY->doc_var(QUERY, "Status of an operation which completed.");
+    QUERY->add_svar(QUERY, "int", "FAILED", TRUE, &pluginop_failed);
+    QUERY->doc_var(QUERY, "Status of an operation which failed, see error().");
+    QUERY->add_svar(QUERY, "int", "CANCELLED", TRUE, &pluginop_cancelled);
+    QUERY->doc_var(QUERY, "Status of an operation which was stopped by cancel().");
+
+    QUERY->add_mfun(QUERY, pluginop_id, "int", "id");
+    QUERY->doc_func(QUERY, "Get the operation's id, unique across all hosts.");
+
+    QUERY->add_mfun(QUERY, pluginop_status, "int", "status");
+    QUERY->doc_func(QUERY, "Get the operation's status (PluginOp.PENDING, DONE, FAILED or CANCELLED).");
+
+    QUERY->add_mfun(QUERY, pluginop_done, "int", "done");
+    QUERY->doc_func(QUERY, "Check if the operation has finished, whether it completed, failed or was cancelled.");
+
+    QUERY->add_mfun(QUERY, pluginop_ok, "int", "ok");
+    QUERY->doc_func(QUERY, "Check if the operation completed.");
+
+    QUERY->add_mfun(QUERY, pluginop_error, "string", "error");
+    QUERY->doc_func(QUERY, "Get why the operation failed (empty unless it failed).");
+
+    QUERY->add_mfun(QUERY, pluginop_cancel, "int", "cancel");
+    QUERY->doc_func(QUERY, "Stop the operation before its next step, e.g. before a plugin being loaded is installed. A step already running completes. Returns false if the operation had finished already.");
+
+    pluginop_data_offset = QUERY->add_mvar(QUERY, "int", "@op_data", false);
+
+    QUERY->end_class(QUERY);
+
+    //-------------------------------------------------------------------------
+    // PluginMod
+    // the modulation inputs of a PluginHost, declared before PluginHost as modInput() takes one
+    //-------------------------------------------------------------------------
+    QUERY->begin_class(QUERY, "PluginMod", "UGen");
+    QUERY->doc_class(QUERY, "Modulation inputs for a PluginHost, which modulate() maps to parameters. Connect the signals to its inputs (input i is mod.chan(i)), connect it to the host (its output is silent) so it's ticked just before, and hand it to plugin.modInput(). Hosts without one have no modulation inputs.");
+
+    QUERY->add_ctor(QUERY, pluginmod_ctor);
+    QUERY->add_dtor(QUERY, pluginmod_dtor);
+
+    QUERY->add_ugen_funcf(QUERY, pluginmod_tick, NULL, ModulationInput::numInputs, 1);
+
+    pluginmod_data_offset = QUERY->add_mvar(QUERY, "int", "@pm_data", false);
+
+    QUERY->end_class(QUERY);
+
     QUERY->begin_class(QUERY, "PluginHost", "UGen");
     QUERY->doc_class(QUERY, "A host for external plugins.");
 
@@ -899,25 +2685,134 @@ CK_DLL_QUERY( PluginHost )
 
     QUERY->add_mfun(QUERY, pluginhost_getParamName, "string", "paramName");
     QUERY->add_arg(QUERY, "int", "index");
-    QUERY->doc_func(QUERY, "Get parameter name.");
+    QUERY->doc_func(QUERY, "Get parameter name.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParamLabel, "string", "paramLabel");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter label.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParamDisplay, "string", "paramDisplay");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter display value.");
+
+    QUERY->add_mfun(QUERY, pluginhost_numParams, "int", "numParams");
+    QUERY->doc_func(QUERY, "Get number of parameters.");
+
+    QUERY->add_mfun(QUERY, pluginhost_numNonMidiParams, "int", "numNonMidiParams");
+    QUERY->doc_func(QUERY, "Get number of non-MIDI parameters.");
+
+    QUERY->add_mfun(QUERY, pluginhost_findParam, "int", "findParam");
+    QUERY->add_arg(QUERY, "string", "name");
+    QUERY->doc_func(QUERY, "Find parameter index by name.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParamId, "string", "paramId");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get the stable parameter ID of the plugin format (empty if it has none).");
+
+    QUERY->add_mfun(QUERY, pluginhost_findParamId, "int", "findParamId");
+    QUERY->add_arg(QUERY, "string", "id");
+    QUERY->doc_func(QUERY, "Find parameter index by stable ID.");
+
+    QUERY->add_mfun(QUERY, pluginhost_nonMidiParam, "int", "nonMidiParam");
+    QUERY->add_arg(QUERY, "int", "n");
+    QUERY->doc_func(QUERY, "Get the index of the n-th parameter that isn't a MIDI CC mapping, -1 if out of range.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParamDefault, "float", "paramDefault");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter default value (0.0 to 1.0).");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParamSteps, "int", "paramSteps");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get number of steps of a discrete parameter, 0 if it's continuous.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setParams, "int", "params");
+    QUERY->add_arg(QUERY, "int[]", "indices");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Set many parameter values at once, values[i] goes to parameter indices[i]. Returns the number of parameters set.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setParamsIfChanged, "int", "setParamsIfChanged");
+    QUERY->add_arg(QUERY, "int[]", "indices");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Like params, but skip values equal to the parameter's current one. Returns the number of parameters set.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParams, "int", "getParams");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Fill the array with the values of all parameters, in index order. Returns the number of parameters.");
+
+    QUERY->add_mfun(QUERY, pluginhost_paramChanged, "Event", "paramChanged");
+    QUERY->doc_func(QUERY, "Get the event broadcast after the plugin changed parameters itself (e.g. in its editor). Read the changes with recvParamChange().");
+
+    QUERY->add_mfun(QUERY, pluginhost_recvParamChange, "int", "recvParamChange");
+    QUERY->doc_func(QUERY, "Take the next parameter the plugin changed. Returns 1 if there was one, it's then available from paramChangeIndex(), paramChangeValue() and paramChangeStage().");
+
+    QUERY->add_mfun(QUERY, pluginhost_paramChangeStage, "int", "paramChangeStage");
+    QUERY->doc_func(QUERY, "Get the stage of the parameter taken by recvParamChange() (always 0 for a plain PluginHost).");
+
+    QUERY->add_mfun(QUERY, pluginhost_paramChangeIndex, "int", "paramChangeIndex");
+    QUERY->doc_func(QUERY, "Get the index of the parameter taken by recvParamChange().");
+
+    QUERY->add_mfun(QUERY, pluginhost_paramChangeValue, "float", "paramChangeValue");
+    QUERY->doc_func(QUERY, "Get the latest value of the parameter taken by recvParamChange().");
+
+    //-------------------------------------------------------------------------
+    // parameter automation functions
+    //-------------------------------------------------------------------------
+    QUERY->add_mfun(QUERY, pluginhost_rampParam, "float", "param");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->add_arg(QUERY, "float", "target");
+    QUERY->add_arg(QUERY, "dur", "length");
+    QUERY->doc_func(QUERY, "Ramp a parameter linearly from its current value to target (0-1) over length. The ramp runs on the audio thread, no shred has to wake up for each step.");
 
-    QUERY->add_mfun(QUERY, pluginhost_getParamLabel, "string", "paramLabel");
+    QUERY->add_mfun(QUERY, pluginhost_rampParamExp, "float", "paramExp");
     QUERY->add_arg(QUERY, "int", "index");
-    QUERY->doc_func(QUERY, "Get parameter label.");
+    QUERY->add_arg(QUERY, "float", "target");
+    QUERY->add_arg(QUERY, "dur", "length");
+    QUERY->doc_func(QUERY, "Ramp a parameter along an exponential curve from its current value to target (0-1) over length.");
 
-    QUERY->add_mfun(QUERY, pluginhost_getParamDisplay, "string", "paramDisplay");
+    QUERY->add_mfun(QUERY, pluginhost_rampParamSegments, "void", "paramSegments");
     QUERY->add_arg(QUERY, "int", "index");
-    QUERY->doc_func(QUERY, "Get parameter display value.");
+    QUERY->add_arg(QUERY, "float[]", "targets");
+    QUERY->add_arg(QUERY, "dur[]", "lengths");
+    QUERY->doc_func(QUERY, "Ramp a parameter linearly through a list of targets (0-1), each reached after the matching length (up to 32 segments).");
 
-    QUERY->add_mfun(QUERY, pluginhost_numParams, "int", "numParams");
-    QUERY->doc_func(QUERY, "Get number of parameters.");
+    QUERY->add_mfun(QUERY, pluginhost_paramLFO, "void", "paramLFO");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->add_arg(QUERY, "int", "shape");
+    QUERY->add_arg(QUERY, "float", "freq");
+    QUERY->add_arg(QUERY, "float", "center");
+    QUERY->add_arg(QUERY, "float", "depth");
+    QUERY->doc_func(QUERY, "Modulate a parameter with an LFO on the audio thread: center +/- depth (clipped to 0-1) at freq Hz. Shape is one of PluginHost.LFO_SINE, LFO_TRIANGLE, LFO_SAW, LFO_SQUARE. Replaces any ramp or LFO on the parameter.");
 
-    QUERY->add_mfun(QUERY, pluginhost_numNonMidiParams, "int", "numNonMidiParams");
-    QUERY->doc_func(QUERY, "Get number of non-MIDI parameters.");
+    QUERY->add_mfun(QUERY, pluginhost_stopParam, "void", "stopParam");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Stop the ramp or LFO on a parameter (-1 for all parameters), leaving it at its current value. Setting the parameter stops them as well.");
 
-    QUERY->add_mfun(QUERY, pluginhost_findParam, "int", "findParam");
-    QUERY->add_arg(QUERY, "string", "name");
-    QUERY->doc_func(QUERY, "Find parameter index by name.");
+    QUERY->add_mfun(QUERY, pluginhost_modulate, "void", "modulate");
+    QUERY->add_arg(QUERY, "int", "input");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->add_arg(QUERY, "float", "center");
+    QUERY->add_arg(QUERY, "float", "depth");
+    QUERY->doc_func(QUERY, "Drive a parameter from a modulation input: center + depth * signal, clipped to 0-1. Modulation input i is input i of the PluginMod set with modInput(), e.g. lfo => mod.chan(0). The input is read once every minSubBlockSize samples.");
+
+    QUERY->add_mfun(QUERY, pluginhost_unmodulate, "void", "unmodulate");
+    QUERY->add_arg(QUERY, "int", "input");
+    QUERY->doc_func(QUERY, "Stop driving a parameter from a modulation input (-1 for all inputs).");
+
+    QUERY->add_mfun(QUERY, pluginhost_modInput, "void", "modInput");
+    QUERY->add_arg(QUERY, "PluginMod", "mod");
+    QUERY->doc_func(QUERY, "Take the modulation inputs from a PluginMod (kept alive while it's used). Pass null to stop, the inputs are then silent.");
+
+    QUERY->add_svar(QUERY, "int", "MOD_INPUTS", TRUE, &pluginhost_mod_inputs);
+    QUERY->doc_var(QUERY, "Number of modulation inputs (inputs of a PluginMod).");
+
+    QUERY->add_svar(QUERY, "int", "LFO_SINE", TRUE, &pluginhost_lfo_sine);
+    QUERY->doc_var(QUERY, "Sine LFO shape.");
+    QUERY->add_svar(QUERY, "int", "LFO_TRIANGLE", TRUE, &pluginhost_lfo_triangle);
+    QUERY->doc_var(QUERY, "Triangle LFO shape.");
+    QUERY->add_svar(QUERY, "int", "LFO_SAW", TRUE, &pluginhost_lfo_saw);
+    QUERY->doc_var(QUERY, "Rising saw LFO shape.");
+    QUERY->add_svar(QUERY, "int", "LFO_SQUARE", TRUE, &pluginhost_lfo_square);
+    QUERY->doc_var(QUERY, "Square LFO shape.");
 
     //-------------------------------------------------------------------------
     // program functions
@@ -925,9 +2820,9 @@ CK_DLL_QUERY( PluginHost )
     QUERY->add_mfun(QUERY, pluginhost_numPrograms, "int", "numPrograms");
     QUERY->doc_func(QUERY, "Get number of programs.");
 
-    QUERY->add_mfun(QUERY, pluginhost_program, "int", "program");
+    QUERY->add_mfun(QUERY, pluginhost_program, "PluginOp", "program");
     QUERY->add_arg(QUERY, "int", "index");
-    QUERY->doc_func(QUERY, "Set current program index.");
+    QUERY->doc_func(QUERY, "Set current program index. Returns the operation.");
 
     QUERY->add_mfun(QUERY, pluginhost_getProgram, "int", "program");
     QUERY->doc_func(QUERY, "Get current program index.");
@@ -939,9 +2834,31 @@ CK_DLL_QUERY( PluginHost )
     //-------------------------------------------------------------------------
     // other functions
     //-------------------------------------------------------------------------
-    QUERY->add_mfun(QUERY, pluginhost_load, "void", "load");
+    QUERY->add_mfun(QUERY, pluginhost_load, "PluginOp", "load");
     QUERY->add_arg(QUERY, "string", "path");
-    QUERY->doc_func(QUERY, "Load a plugin from a file path.");
+    QUERY->doc_func(QUERY, "Load a plugin from a file path. Returns the operation, which can be waited on: plugin.load(path) => now.");
+
+    QUERY->add_mfun(QUERY, pluginhost_preload, "void", "preload");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->add_arg(QUERY, "int", "count");
+    QUERY->doc_func(QUERY, "Create and prepare count instances of a plugin in the background and keep them in a pool shared by all PluginHosts. Loading the plugin (load, add, insert, replace) then takes a ready instance instead of creating one.");
+
+    QUERY->add_mfun(QUERY, pluginhost_preloaded, "int", "preloaded");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Get the number of ready instances of a plugin in the pool.");
+
+    QUERY->add_mfun(QUERY, pluginhost_clearPreloaded, "void", "clearPreloaded");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Destroy the pooled instances of a plugin, or of all plugins if path is empty.");
+
+    QUERY->add_mfun(QUERY, pluginhost_clone, "void", "clone");
+    QUERY->add_arg(QUERY, "PluginHost", "source");
+    QUERY->doc_func(QUERY, "Load a new instance of source's plugin in its current state, without scanning (taken from the pool if one is preloaded).");
+
+    QUERY->add_mfun(QUERY, pluginhost_cloneStage, "void", "clone");
+    QUERY->add_arg(QUERY, "PluginHost", "source");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Load a new instance of the plugin at a stage of source's chain in its current state.");
 
     QUERY->add_mfun(QUERY, pluginhost_name, "string", "name");
     QUERY->doc_func(QUERY, "Get the plugin name.");
@@ -953,9 +2870,9 @@ CK_DLL_QUERY( PluginHost )
     QUERY->add_arg(QUERY, "string", "path");
     QUERY->doc_func(QUERY, "Save plugin state to a file.");
 
-    QUERY->add_mfun(QUERY, pluginhost_loadState, "void", "loadState");
+    QUERY->add_mfun(QUERY, pluginhost_loadState, "PluginOp", "loadState");
     QUERY->add_arg(QUERY, "string", "path");
-    QUERY->doc_func(QUERY, "Load plugin state from a file.");
+    QUERY->doc_func(QUERY, "Load plugin state from a file. Returns the operation, which can be waited on.");
 
     QUERY->add_mfun(QUERY, pluginhost_showEditor, "void", "showEditor");
     QUERY->doc_func(QUERY, "Show the plugin editor window.");
@@ -969,6 +2886,12 @@ CK_DLL_QUERY( PluginHost )
     QUERY->add_mfun(QUERY, pluginhost_waitForAsyncEvents, "void", "waitForAsyncEvents");
     QUERY->doc_func(QUERY, "Wait for all async events to finish. WARNING: This is not realtime safe and should only be used in non-realtime contexts (such as setup) or for debugging.");
 
+    QUERY->add_mfun(QUERY, pluginhost_lastOp, "PluginOp", "lastOp");
+    QUERY->doc_func(QUERY, "Get the operation started last by this host, e.g. by program() or blockSize(), which can be waited on: plugin.lastOp() => now.");
+
+    QUERY->add_mfun(QUERY, pluginhost_merged, "int", "merged");
+    QUERY->doc_func(QUERY, "Get the number of program(), blockSize(), showEditor() / hideEditor() and loadState() calls that were merged into an identical call (same stage) made right after them, before they had started. Their operations are cancelled. Async mode only.");
+
     QUERY->add_mfun(QUERY, pluginhost_setForceSynchronous, "int", "forceSynchronous");
     QUERY->add_arg(QUERY, "int", "b");
     QUERY->doc_func(QUERY, "Set whether to force synchronous execution of main thread events. If true, there is no need to wait on asynchronous events, but audio processing may block.");
@@ -976,15 +2899,103 @@ CK_DLL_QUERY( PluginHost )
     QUERY->add_mfun(QUERY, pluginhost_getForceSynchronous, "int", "forceSynchronous");
     QUERY->doc_func(QUERY, "Get whether synchronous execution of main thread events is forced.");
 
-    QUERY->add_mfun(QUERY, pluginhost_setBlockSize, "int", "blockSize");
+    QUERY->add_mfun(QUERY, pluginhost_setBlockSize, "PluginOp", "blockSize");
     QUERY->add_arg(QUERY, "int", "size");
-    QUERY->doc_func(QUERY, "Set the block size for plugin processing. This introduces a delay in exchange for more efficient processing.");
+    QUERY->doc_func(QUERY, "Set the block size for plugin processing. This introduces a delay in exchange for more efficient processing. Returns the operation.");
 
     QUERY->add_mfun(QUERY, pluginhost_getBlockSize, "int", "blockSize");
     QUERY->doc_func(QUERY, "Get the block size for plugin processing.");
 
+    QUERY->add_mfun(QUERY, pluginhost_setMaxBlockSize, "PluginOp", "maxBlockSize");
+    QUERY->add_arg(QUERY, "int", "size");
+    QUERY->doc_func(QUERY, "Set the maximum block size the plugin is prepared for (default 256, up to 16384). The block size can't exceed this. Changing it re-prepares a loaded plugin.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getMaxBlockSize, "int", "maxBlockSize");
+    QUERY->doc_func(QUERY, "Get the maximum block size the plugin is prepared for.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setMinSubBlockSize, "int", "minSubBlockSize");
+    QUERY->add_arg(QUERY, "int", "size");
+    QUERY->doc_func(QUERY, "Set the smallest piece a block is split into to apply a parameter change at its exact sample (default 16). Changes closer together than this are applied together.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getMinSubBlockSize, "int", "minSubBlockSize");
+    QUERY->doc_func(QUERY, "Get the smallest piece a block is split into for parameter changes.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setCrossfade, "dur", "crossfade");
+    QUERY->add_arg(QUERY, "dur", "length");
+    QUERY->doc_func(QUERY, "Set how long the old plugins keep running and fade out while newly loaded ones fade in (default 0, swap immediately, up to 10 seconds).");
+
+    QUERY->add_mfun(QUERY, pluginhost_getCrossfade, "dur", "crossfade");
+    QUERY->doc_func(QUERY, "Get the crossfade length used when plugins are replaced.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setDirectProcessing, "int", "directProcessing");
+    QUERY->add_arg(QUERY, "int", "b");
+    QUERY->doc_func(QUERY, "Set whether to pass every tick straight to the plugin, with however many frames ChucK provides (split at maxBlockSize). Removes the block size delay, at the cost of calling the plugin more often with small blocks.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getDirectProcessing, "int", "directProcessing");
+    QUERY->doc_func(QUERY, "Get whether ticks are passed straight to the plugin.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setAsync, "int", "async");
+    QUERY->add_arg(QUERY, "int", "b");
+    QUERY->doc_func(QUERY, "Set whether to run the plugin on its own realtime thread, one block ahead of ChucK. Frees up the ChucK audio thread for heavy plugins, at the cost of one extra block of latency. Not used together with directProcessing.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getAsync, "int", "async");
+    QUERY->doc_func(QUERY, "Get whether the plugin runs on its own thread.");
+
+    QUERY->add_mfun(QUERY, pluginhost_setParallel, "int", "parallel");
+    QUERY->add_arg(QUERY, "int", "b");
+    QUERY->doc_func(QUERY, "Set whether to process this plugin on the worker pool shared by all PluginHosts, one block ahead of ChucK. Independent instances then run concurrently on different cores, at the cost of one extra block of latency. Takes precedence over async. Not used together with directProcessing.");
+
+    QUERY->add_mfun(QUERY, pluginhost_getParallel, "int", "parallel");
+    QUERY->doc_func(QUERY, "Get whether this plugin is processed on the shared worker pool.");
+
+    QUERY->add_mfun(QUERY, pluginhost_overruns, "int", "overruns");
+    QUERY->doc_func(QUERY, "Get the number of blocks skipped (output as silence) in async / parallel mode because the worker hadn't finished the previous block in time.");
+
+    QUERY->add_sfun(QUERY, pluginhost_setWorkers, "int", "workers");
+    QUERY->add_arg(QUERY, "int", "num");
+    QUERY->doc_func(QUERY, "Set the number of threads in the worker pool shared by all PluginHosts in parallel mode (default: number of cores - 1).");
+
+    QUERY->add_sfun(QUERY, pluginhost_getWorkers, "int", "workers");
+    QUERY->doc_func(QUERY, "Get the number of threads in the shared worker pool.");
+
+    QUERY->add_sfun(QUERY, pluginhost_clearPluginCache, "void", "clearPluginCache");
+    QUERY->doc_func(QUERY, "Forget the cached scan results of all plugins and the scan blacklist, so each one is scanned again the next time it's loaded.");
+
+    QUERY->add_sfun(QUERY, pluginhost_scanPlugins, "void", "scanPlugins");
+    QUERY->doc_func(QUERY, "Scan the standard plugin directories in the background, each file in a separate process. Files which crash or hang the scan are blacklisted. Already known plugins are only scanned again if their file changed.");
+
+    QUERY->add_sfun(QUERY, pluginhost_scanPluginsIn, "void", "scanPlugins");
+    QUERY->add_arg(QUERY, "string", "directory");
+    QUERY->doc_func(QUERY, "Scan the standard plugin directories and the given one in the background.");
+
+    QUERY->add_sfun(QUERY, pluginhost_scanningPlugins, "int", "scanningPlugins");
+    QUERY->doc_func(QUERY, "Get whether a plugin scan is running.");
+
+    QUERY->add_sfun(QUERY, pluginhost_searchPlugins, "int", "searchPlugins");
+    QUERY->add_arg(QUERY, "string", "query");
+    QUERY->doc_func(QUERY, "Search the known plugins for ones whose name, vendor, category or format contains the query (ignoring case, empty matches all). Returns the number of matches, read them with foundPluginPath() etc.");
+
+    QUERY->add_sfun(QUERY, pluginhost_foundPluginPath, "string", "foundPluginPath");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get the file of a match of the last search, to pass to load().");
+
+    QUERY->add_sfun(QUERY, pluginhost_foundPluginName, "string", "foundPluginName");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get the name of a match of the last search.");
+
+    QUERY->add_sfun(QUERY, pluginhost_foundPluginVendor, "string", "foundPluginVendor");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get the vendor of a match of the last search.");
+
+    QUERY->add_sfun(QUERY, pluginhost_foundPluginCategory, "string", "foundPluginCategory");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get the category of a match of the last search.");
+
     QUERY->add_mfun(QUERY, pluginhost_latency, "int", "latency");
-    QUERY->doc_func(QUERY, "Get plugin latency in samples.");
+    QUERY->doc_func(QUERY, "Get plugin latency in samples. For a PluginChain this is the sum over all stages, for a PluginGraph the longest path to the output (shorter parallel paths are delayed to match).");
+
+    QUERY->add_mfun(QUERY, pluginhost_totalLatency, "int", "totalLatency");
+    QUERY->doc_func(QUERY, "Get the total latency in samples from input to output, i.e. the plugin latency plus the delay added by block accumulation and async / parallel processing.");
 
     QUERY->add_mfun(QUERY, pluginhost_setBypass, "int", "bypass");
     QUERY->add_arg(QUERY, "int", "b");
@@ -1154,118 +3165,523 @@ CK_DLL_QUERY( PluginHost )
     QUERY->add_arg(QUERY, "int", "byte3");
     QUERY->doc_func(QUERY, "Send a raw 3-byte MIDI message.");
 
-    QUERY->add_mfun(QUERY, pluginhost_addQWERTYMidiInput, "void", "addQWERTYMidiInput");
-    QUERY->doc_func(QUERY, "Add a QWERTY MIDI input window to route computer keyboard input to the plugin.");
+    QUERY->add_mfun(QUERY, pluginhost_noteOnArray, "void", "noteOn");
+    QUERY->add_arg(QUERY, "int[]", "notes");
+    QUERY->add_arg(QUERY, "float", "velocity");
+    QUERY->add_arg(QUERY, "int", "channel");
+    QUERY->doc_func(QUERY, "Send a MIDI Note On message for each of the notes (e.g. a chord), all at the same time. Channel is 1-16.");
+
+    QUERY->add_mfun(QUERY, pluginhost_noteOnArray_default, "void", "noteOn");
+    QUERY->add_arg(QUERY, "int[]", "notes");
+    QUERY->add_arg(QUERY, "float", "velocity");
+    QUERY->doc_func(QUERY, "Send a MIDI Note On message for each of the notes on default channel 1.");
+
+    QUERY->add_mfun(QUERY, pluginhost_noteOffArray, "void", "noteOff");
+    QUERY->add_arg(QUERY, "int[]", "notes");
+    QUERY->add_arg(QUERY, "int", "channel");
+    QUERY->doc_func(QUERY, "Send a MIDI Note Off message for each of the notes. Channel is 1-16.");
+
+    QUERY->add_mfun(QUERY, pluginhost_noteOffArray_default, "void", "noteOff");
+    QUERY->add_arg(QUERY, "int[]", "notes");
+    QUERY->doc_func(QUERY, "Send a MIDI Note Off message for each of the notes on default channel 1.");
+
+    QUERY->add_mfun(QUERY, pluginhost_midiMsgArray, "void", "midiMsg");
+    QUERY->add_arg(QUERY, "int[]", "bytes");
+    QUERY->doc_func(QUERY, "Send several raw 3-byte MIDI messages, given as consecutive byte triples.");
+
+    QUERY->add_mfun(QUERY, pluginhost_midiOut, "Event", "midiOut");
+    QUERY->doc_func(QUERY, "Get the event broadcast after each block in which the plugin output MIDI. Output MIDI is collected from the first call on, read it with recvMidiOut().");
+
+    QUERY->add_mfun(QUERY, pluginhost_recvMidiOut, "int", "recvMidiOut");
+    QUERY->doc_func(QUERY, "Take the next MIDI message output by the plugin. Returns 1 if there was one, its contents are then available from midiOutData() and midiOutTime().");
+
+    QUERY->add_mfun(QUERY, pluginhost_midiOutData, "int", "midiOutData");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get byte 0-2 of the message taken by recvMidiOut().");
+
+    QUERY->add_mfun(QUERY, pluginhost_midiOutTime, "time", "midiOutTime");
+    QUERY->doc_func(QUERY, "Get the time of the sample the message taken by recvMidiOut() belongs to, within the block it came out with.");
+
+    QUERY->add_mfun(QUERY, pluginhost_forwardMidi, "void", "forwardMidi");
+    QUERY->add_arg(QUERY, "PluginHost", "target");
+    QUERY->doc_func(QUERY, "Send the plugin's output MIDI straight to another PluginHost's MIDI input, sample accurately and without going through a shred. Pass null to stop.");
+
+    QUERY->add_mfun(QUERY, pluginhost_addQWERTYMidiInput, "void", "addQWERTYMidiInput");
+    QUERY->doc_func(QUERY, "Add a QWERTY MIDI input window to route computer keyboard input to the plugin.");
+
+    QUERY->add_mfun(QUERY, pluginhost_removeQWERTYMidiInput, "void", "removeQWERTYMidiInput");
+    QUERY->doc_func(QUERY, "Remove the QWERTY MIDI input window.");
+
+    QUERY->add_mfun(QUERY, pluginhost_toggleQWERTYMidiInput, "void", "toggleQWERTYMidiInput");
+    QUERY->doc_func(QUERY, "Toggle the QWERTY MIDI input window.");
+
+    //-------------------------------------------------------------------------
+    // data offset
+    //-------------------------------------------------------------------------
+    // reserve a variable for internal class pointer
+    pluginhost_data_offset = QUERY->add_mvar(QUERY, "int", "@ph_data", false);
+
+    QUERY->end_class(QUERY);
+
+    //-------------------------------------------------------------------------
+    // PluginChain
+    // a PluginHost running several plugins back to back - the PluginHost constructor
+    // creates the (shared) host object, all PluginHost functions act on stage 0
+    //-------------------------------------------------------------------------
+    QUERY->begin_class(QUERY, "PluginChain", "PluginHost");
+    QUERY->doc_class(QUERY, "A chain of plugins processed back to back in one UGen. Audio stays in one buffer between stages and each stage receives the MIDI output of the stage before it, without the extra conversion and delay of chaining PluginHosts. The inherited PluginHost functions act on the first stage, load() replaces the whole chain.");
+
+    QUERY->add_ugen_funcf(QUERY, pluginhost_tick, NULL, PluginHost::maxChannels, PluginHost::maxChannels);
+
+    QUERY->add_mfun(QUERY, pluginchain_add, "PluginOp", "add");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Load a plugin and append it to the end of the chain.");
+
+    QUERY->add_mfun(QUERY, pluginchain_insert, "PluginOp", "insert");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Load a plugin and insert it at the given stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_load, "PluginOp", "load");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Load a plugin, replacing the given stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_remove, "void", "remove");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Remove a stage from the chain.");
+
+    QUERY->add_mfun(QUERY, pluginchain_move, "void", "move");
+    QUERY->add_arg(QUERY, "int", "from");
+    QUERY->add_arg(QUERY, "int", "to");
+    QUERY->doc_func(QUERY, "Move a stage to a new position in the chain.");
+
+    QUERY->add_mfun(QUERY, pluginchain_size, "int", "size");
+    QUERY->doc_func(QUERY, "Get the number of stages in the chain.");
+
+    // not param(), param(int stage, int index) would be ambiguous with the inherited param(int index, float value)
+    QUERY->add_mfun(QUERY, pluginchain_setParam, "float", "stageParam");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->add_arg(QUERY, "float", "value");
+    QUERY->doc_func(QUERY, "Set parameter value of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_getParam, "float", "stageParam");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter value of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_getParamName, "string", "paramName");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter name of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_getParamDisplay, "string", "paramDisplay");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Get parameter display value of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_numParams, "int", "numParams");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Get number of parameters of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_findParam, "int", "findParam");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "string", "name");
+    QUERY->doc_func(QUERY, "Find parameter index of a stage by name.");
+
+    QUERY->add_mfun(QUERY, pluginchain_setParams, "int", "params");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int[]", "indices");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Set many parameter values of a stage at once.");
+
+    QUERY->add_mfun(QUERY, pluginchain_setParamsIfChanged, "int", "setParamsIfChanged");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int[]", "indices");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Set many parameter values of a stage at once, skipping unchanged ones.");
+
+    QUERY->add_mfun(QUERY, pluginchain_getParams, "int", "getParams");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "float[]", "values");
+    QUERY->doc_func(QUERY, "Fill the array with the values of all parameters of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_program, "PluginOp", "program");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "index");
+    QUERY->doc_func(QUERY, "Set current program index of a stage. Returns the operation.");
+
+    QUERY->add_mfun(QUERY, pluginchain_name, "string", "name");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Get the plugin name of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_saveState, "void", "saveState");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Save the plugin state of a stage to a file.");
+
+    QUERY->add_mfun(QUERY, pluginchain_loadState, "PluginOp", "loadState");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "string", "path");
+    QUERY->doc_func(QUERY, "Load the plugin state of a stage from a file.");
+
+    QUERY->add_mfun(QUERY, pluginchain_showEditor, "void", "showEditor");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Show the plugin editor of a stage.");
+
+    QUERY->add_mfun(QUERY, pluginchain_hideEditor, "void", "hideEditor");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Hide the plugin editor of a stage.");
+
+    // not bypass(), bypass(int stage) would override the inherited bypass(int b)
+    QUERY->add_mfun(QUERY, pluginchain_setBypass, "int", "stageBypass");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->add_arg(QUERY, "int", "b");
+    QUERY->doc_func(QUERY, "Set whether a stage is bypassed (skipped).");
+
+    QUERY->add_mfun(QUERY, pluginchain_getBypass, "int", "stageBypass");
+    QUERY->add_arg(QUERY, "int", "stage");
+    QUERY->doc_func(QUERY, "Get whether a stage is bypassed.");
+
+    QUERY->end_class(QUERY);
+
+    //-------------------------------------------------------------------------
+    // PluginGraph
+    // a PluginChain whose stages are routed through connections
+    //-------------------------------------------------------------------------
+    QUERY->begin_class(QUERY, "PluginGraph", "PluginChain");
+    QUERY->doc_class(QUERY, "A graph of plugins in one UGen, for split/merge routings like parallel effects or layered synths. The stages of the chain are the nodes (numbered in the order they're added), connections carry audio (summed) or MIDI (merged) between them. Nodes only run if they lead to PluginGraph.OUT, and independent branches are processed concurrently on the shared worker pool.");
+
+    QUERY->add_ctor(QUERY, plugingraph_ctor);
+
+    QUERY->add_ugen_funcf(QUERY, pluginhost_tick, NULL, PluginHost::maxChannels, PluginHost::maxChannels);
+
+    QUERY->add_svar(QUERY, "int", "IN", TRUE, &plugingraph_in);
+    QUERY->doc_var(QUERY, "Node id of the graph input (the UGen's input, and the MIDI functions for MIDI connections).");
+
+    QUERY->add_svar(QUERY, "int", "OUT", TRUE, &plugingraph_out);
+    QUERY->doc_var(QUERY, "Node id of the graph output.");
+
+    QUERY->add_mfun(QUERY, plugingraph_connect, "void", "connect");
+    QUERY->add_arg(QUERY, "int", "from");
+    QUERY->add_arg(QUERY, "int", "to");
+    QUERY->doc_func(QUERY, "Connect the audio output of a node to the input of another. Connections which would create a feedback loop are refused.");
+
+    QUERY->add_mfun(QUERY, plugingraph_connectMidi, "void", "connectMidi");
+    QUERY->add_arg(QUERY, "int", "from");
+    QUERY->add_arg(QUERY, "int", "to");
+    QUERY->doc_func(QUERY, "Connect the MIDI output of a node to the MIDI input of another.");
+
+    QUERY->add_mfun(QUERY, plugingraph_disconnect, "void", "disconnect");
+    QUERY->add_arg(QUERY, "int", "from");
+    QUERY->add_arg(QUERY, "int", "to");
+    QUERY->doc_func(QUERY, "Remove an audio connection.");
+
+    QUERY->add_mfun(QUERY, plugingraph_disconnectMidi, "void", "disconnectMidi");
+    QUERY->add_arg(QUERY, "int", "from");
+    QUERY->add_arg(QUERY, "int", "to");
+    QUERY->doc_func(QUERY, "Remove a MIDI connection.");
+
+    QUERY->add_mfun(QUERY, plugingraph_disconnectAll, "void", "disconnectAll");
+    QUERY->doc_func(QUERY, "Remove all connections.");
+
+    QUERY->end_class(QUERY);
+
+    // register main thread hook
+    Chuck_DL_MainThreadHook * hook = QUERY->create_main_thread_hook( QUERY, pluginhost_main_hook, pluginhost_main_quit, NULL );
+    // activate
+    if( hook ) hook->activate( hook );
+
+    return TRUE;
+}
+
+
+//-----------------------------------------------------------------------------
+// constructor/destructor
+//-----------------------------------------------------------------------------
+CK_DLL_CTOR(pluginhost_ctor)
+{
+    OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = 0;
+    PluginHost * ph_obj = new PluginHost(API->vm->srate(VM), VM, API);
+    OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = (t_CKINT) ph_obj;
+}
+
+CK_DLL_DTOR(pluginhost_dtor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    if( ph_obj )
+    {
+        delete ph_obj;
+        OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// tick function
+//-----------------------------------------------------------------------------
+CK_DLL_TICKF(pluginhost_tick)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    if( ph_obj ) ph_obj->tick(in, out, nframes);
+    return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// PluginMod
+//-----------------------------------------------------------------------------
+CK_DLL_CTOR(pluginmod_ctor)
+{
+    OBJ_MEMBER_INT(SELF, pluginmod_data_offset) = (t_CKINT) new ModulationInput();
+}
+
+CK_DLL_DTOR(pluginmod_dtor)
+{
+    // the hosts using it hold a reference, so none of them can read it any more
+    ModulationInput * pm_obj = (ModulationInput *) OBJ_MEMBER_INT(SELF, pluginmod_data_offset);
+    delete pm_obj;
+    OBJ_MEMBER_INT(SELF, pluginmod_data_offset) = 0;
+}
+
+CK_DLL_TICKF(pluginmod_tick)
+{
+    ModulationInput * pm_obj = (ModulationInput *) OBJ_MEMBER_INT(SELF, pluginmod_data_offset);
+    if( pm_obj ) pm_obj->tick(in, out, nframes);
+    return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// parameter functions
+//-----------------------------------------------------------------------------
+CK_DLL_MFUN(pluginhost_setParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    t_CKFLOAT val = GET_NEXT_FLOAT(ARGS);
+    RETURN->v_float = ph_obj->setParam(index, (float)val);
+}
+
+CK_DLL_MFUN(pluginhost_getParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_float = ph_obj->getParam(index);
+}
+
+CK_DLL_MFUN(pluginhost_getParamName)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamName(index).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_getParamLabel)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamLabel(index).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_getParamDisplay)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamDisplay(index).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_numParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getNumParams();
+}
+
+CK_DLL_MFUN(pluginhost_numNonMidiParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getNumNonMidiParams();
+}
+
+CK_DLL_MFUN(pluginhost_findParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string name = GET_NEXT_STRING_SAFE(ARGS);
+    RETURN->v_int = ph_obj->findParam(name);
+}
+
+CK_DLL_MFUN(pluginhost_getParamId)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamId(index).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_findParamId)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string id = GET_NEXT_STRING_SAFE(ARGS);
+    RETURN->v_int = ph_obj->findParamById(id);
+}
 
-    QUERY->add_mfun(QUERY, pluginhost_removeQWERTYMidiInput, "void", "removeQWERTYMidiInput");
-    QUERY->doc_func(QUERY, "Remove the QWERTY MIDI input window.");
+CK_DLL_MFUN(pluginhost_nonMidiParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT n = GET_NEXT_INT(ARGS);
+    RETURN->v_int = ph_obj->getNonMidiParam(n);
+}
 
-    QUERY->add_mfun(QUERY, pluginhost_toggleQWERTYMidiInput, "void", "toggleQWERTYMidiInput");
-    QUERY->doc_func(QUERY, "Toggle the QWERTY MIDI input window.");
+CK_DLL_MFUN(pluginhost_getParamDefault)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_float = ph_obj->getParamDefault(index);
+}
 
-    //-------------------------------------------------------------------------
-    // data offset
-    //-------------------------------------------------------------------------
-    // reserve a variable for internal class pointer
-    pluginhost_data_offset = QUERY->add_mvar(QUERY, "int", "@ph_data", false);
+CK_DLL_MFUN(pluginhost_getParamSteps)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_int = ph_obj->getParamNumSteps(index);
+}
 
-    QUERY->end_class(QUERY);
+CK_DLL_MFUN(pluginhost_setParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * indices = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->setParams(indices, values, false);
+}
 
-    // register main thread hook
-    Chuck_DL_MainThreadHook * hook = QUERY->create_main_thread_hook( QUERY, pluginhost_main_hook, pluginhost_main_quit, NULL );
-    // activate
-    if( hook ) hook->activate( hook );
+CK_DLL_MFUN(pluginhost_setParamsIfChanged)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * indices = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->setParams(indices, values, true);
+}
 
-    return TRUE;
+CK_DLL_MFUN(pluginhost_getParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->getParams(values);
 }
 
+CK_DLL_MFUN(pluginhost_paramChanged)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_object = ph_obj ? (Chuck_Object *) ph_obj->getParamChangedEvent() : NULL;
+}
 
-//-----------------------------------------------------------------------------
-// constructor/destructor
-//-----------------------------------------------------------------------------
-CK_DLL_CTOR(pluginhost_ctor)
+CK_DLL_MFUN(pluginhost_recvParamChange)
 {
-    OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = 0;
-    PluginHost * ph_obj = new PluginHost(API->vm->srate(VM));
-    OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = (t_CKINT) ph_obj;
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj ? ph_obj->recvParamChange() : 0;
 }
 
-CK_DLL_DTOR(pluginhost_dtor)
+CK_DLL_MFUN(pluginhost_paramChangeStage)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    if( ph_obj )
-    {
-        delete ph_obj;
-        OBJ_MEMBER_INT(SELF, pluginhost_data_offset) = 0;
-    }
+    RETURN->v_int = ph_obj ? ph_obj->getParamChangeStage() : -1;
 }
 
-//-----------------------------------------------------------------------------
-// tick function
-//-----------------------------------------------------------------------------
-CK_DLL_TICKF(pluginhost_tick)
+CK_DLL_MFUN(pluginhost_paramChangeIndex)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    if( ph_obj ) ph_obj->tick(in, out, nframes);
-    return TRUE;
+    RETURN->v_int = ph_obj ? ph_obj->getParamChangeIndex() : -1;
+}
+
+CK_DLL_MFUN(pluginhost_paramChangeValue)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_float = ph_obj ? ph_obj->getParamChangeValue() : 0.0;
 }
 
 //-----------------------------------------------------------------------------
-// parameter functions
+// parameter automation functions
 //-----------------------------------------------------------------------------
-CK_DLL_MFUN(pluginhost_setParam)
+CK_DLL_MFUN(pluginhost_rampParam)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    t_CKFLOAT val = GET_NEXT_FLOAT(ARGS);
-    RETURN->v_float = ph_obj->setParam(index, (float)val);
+    t_CKFLOAT target = GET_NEXT_FLOAT(ARGS);
+    t_CKDUR length = GET_NEXT_DUR(ARGS);
+    ph_obj->rampParam(index, (float)target, length, false);
+    RETURN->v_float = target;
 }
 
-CK_DLL_MFUN(pluginhost_getParam)
+CK_DLL_MFUN(pluginhost_rampParamExp)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    RETURN->v_float = ph_obj->getParam(index);
+    t_CKFLOAT target = GET_NEXT_FLOAT(ARGS);
+    t_CKDUR length = GET_NEXT_DUR(ARGS);
+    ph_obj->rampParam(index, (float)target, length, true);
+    RETURN->v_float = target;
 }
 
-CK_DLL_MFUN(pluginhost_getParamName)
+CK_DLL_MFUN(pluginhost_rampParamSegments)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamName(index).c_str(), false);
+    Chuck_ArrayFloat * targets = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * lengths = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    if( !targets || !lengths ) return;
+
+    // queued together, each segment follows on from the one before on the audio thread
+    t_CKINT num = std::min(API->object->array_float_size(targets), API->object->array_float_size(lengths));
+    if( num > ParameterAutomation::maxSegments )
+    {
+        std::cout << "PluginHost: only the first " << ParameterAutomation::maxSegments << " segments are used" << std::endl;
+        num = ParameterAutomation::maxSegments;
+    }
+    for( t_CKINT i = 0; i < num; i++ )
+    {
+        const t_CKDUR length = API->object->array_float_get_idx(lengths, i);
+        ph_obj->rampParam(index, (float)API->object->array_float_get_idx(targets, i), length, false, 0, i > 0);
+    }
 }
 
-CK_DLL_MFUN(pluginhost_getParamLabel)
+CK_DLL_MFUN(pluginhost_paramLFO)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamLabel(index).c_str(), false);
+    t_CKINT shape = GET_NEXT_INT(ARGS);
+    t_CKFLOAT freq = GET_NEXT_FLOAT(ARGS);
+    t_CKFLOAT center = GET_NEXT_FLOAT(ARGS);
+    t_CKFLOAT depth = GET_NEXT_FLOAT(ARGS);
+    ph_obj->setParamLFO(index, shape, (float)freq, (float)center, (float)depth);
 }
 
-CK_DLL_MFUN(pluginhost_getParamDisplay)
+CK_DLL_MFUN(pluginhost_stopParam)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamDisplay(index).c_str(), false);
+    ph_obj->stopParamAutomation(index);
 }
 
-CK_DLL_MFUN(pluginhost_numParams)
+CK_DLL_MFUN(pluginhost_modulate)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_int = ph_obj->getNumParams();
+    t_CKINT input = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    t_CKFLOAT center = GET_NEXT_FLOAT(ARGS);
+    t_CKFLOAT depth = GET_NEXT_FLOAT(ARGS);
+    ph_obj->setModulation(input, index, (float)center, (float)depth);
 }
 
-CK_DLL_MFUN(pluginhost_numNonMidiParams)
+CK_DLL_MFUN(pluginhost_unmodulate)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_int = ph_obj->getNumNonMidiParams();
+    t_CKINT input = GET_NEXT_INT(ARGS);
+    ph_obj->clearModulation(input);
 }
 
-CK_DLL_MFUN(pluginhost_findParam)
+CK_DLL_MFUN(pluginhost_modInput)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    std::string name = GET_NEXT_STRING_SAFE(ARGS);
-    RETURN->v_int = ph_obj->findParam(name);
+    Chuck_Object * mod_obj = GET_NEXT_OBJECT(ARGS);
+    ModulationInput * mod = mod_obj ? (ModulationInput *) OBJ_MEMBER_INT(mod_obj, pluginmod_data_offset) : NULL;
+    if( ph_obj ) ph_obj->setModulationInput(mod, mod ? mod_obj : NULL);
 }
 
 //-----------------------------------------------------------------------------
@@ -1281,8 +3697,8 @@ CK_DLL_MFUN(pluginhost_program)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     t_CKINT index = GET_NEXT_INT(ARGS);
-    if( ph_obj ) ph_obj->setCurrentProgram(index);
-    RETURN->v_int = index;
+    ph_obj->setCurrentProgram(index);
+    RETURN->v_object = ph_obj->getLastOperationObject();
 }
 
 CK_DLL_MFUN(pluginhost_getProgram)
@@ -1306,84 +3722,290 @@ CK_DLL_MFUN(pluginhost_load)
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     std::string path = GET_NEXT_STRING_SAFE(ARGS);
     ph_obj->loadPlugin(path);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginhost_preload)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    t_CKINT count = GET_NEXT_INT(ARGS);
+    ph_obj->preload(path, (int)count);
+}
+
+CK_DLL_MFUN(pluginhost_preloaded)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    RETURN->v_int = ph_obj->getNumPreloaded(path);
+}
+
+CK_DLL_MFUN(pluginhost_clearPreloaded)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->clearPreloaded(path);
+}
+
+CK_DLL_MFUN(pluginhost_clone)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_Object * source_obj = GET_NEXT_OBJECT(ARGS);
+    PluginHost * source = source_obj ? (PluginHost *) OBJ_MEMBER_INT(source_obj, pluginhost_data_offset) : NULL;
+    if( source ) ph_obj->clonePlugin(*source, source_obj);
+}
+
+CK_DLL_MFUN(pluginhost_cloneStage)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_Object * source_obj = GET_NEXT_OBJECT(ARGS);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    PluginHost * source = source_obj ? (PluginHost *) OBJ_MEMBER_INT(source_obj, pluginhost_data_offset) : NULL;
+    if( source ) ph_obj->clonePlugin(*source, source_obj, (int)stage);
+}
+
+CK_DLL_MFUN(pluginhost_name)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getName().c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_vendor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getVendor().c_str(), false);
+}
+
+CK_DLL_MFUN(pluginhost_saveState)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->saveState(path);
+}
+
+CK_DLL_MFUN(pluginhost_loadState)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->loadState(path);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginhost_showEditor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    ph_obj->showEditor();
+}
+
+CK_DLL_MFUN(pluginhost_hideEditor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    ph_obj->hideEditor();
+}
+
+CK_DLL_MFUN(pluginhost_asyncEventRunning)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->asyncEventRunning();
+}
+
+CK_DLL_MFUN(pluginhost_waitForAsyncEvents)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    ph_obj->waitForAsyncEvents();
+}
+
+CK_DLL_MFUN(pluginhost_lastOp)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginhost_merged)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getNumMergedCommands();
+}
+
+CK_DLL_MFUN(pluginhost_setForceSynchronous)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT b = GET_NEXT_INT(ARGS);
+    ph_obj->setForceSynchronous(b != 0);
+    RETURN->v_int = b;
+}
+
+CK_DLL_MFUN(pluginhost_getForceSynchronous)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getForceSynchronous();
+}
+
+CK_DLL_MFUN(pluginhost_setBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT size = GET_NEXT_INT(ARGS);
+    ph_obj->setBlockSize(size);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginhost_getBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getBlockSize();
+}
+
+CK_DLL_MFUN(pluginhost_setMaxBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT size = GET_NEXT_INT(ARGS);
+    ph_obj->setMaxBlockSize(size);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginhost_getMaxBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getMaxBlockSize();
+}
+
+CK_DLL_MFUN(pluginhost_setMinSubBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT size = GET_NEXT_INT(ARGS);
+    ph_obj->setMinSubBlockSize(size);
+    RETURN->v_int = ph_obj->getMinSubBlockSize();
+}
+
+CK_DLL_MFUN(pluginhost_getMinSubBlockSize)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getMinSubBlockSize();
+}
+
+CK_DLL_MFUN(pluginhost_setCrossfade)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKDUR length = GET_NEXT_DUR(ARGS);
+    ph_obj->setCrossfade(length);
+    RETURN->v_dur = ph_obj->getCrossfade();
+}
+
+CK_DLL_MFUN(pluginhost_getCrossfade)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_dur = ph_obj->getCrossfade();
+}
+
+CK_DLL_MFUN(pluginhost_setDirectProcessing)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT b = GET_NEXT_INT(ARGS);
+    ph_obj->setDirectProcessing(b != 0);
+    RETURN->v_int = b;
+}
+
+CK_DLL_MFUN(pluginhost_getDirectProcessing)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getDirectProcessing();
+}
+
+CK_DLL_MFUN(pluginhost_setAsync)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT b = GET_NEXT_INT(ARGS);
+    ph_obj->setAsync(b != 0);
+    RETURN->v_int = b;
+}
+
+CK_DLL_MFUN(pluginhost_getAsync)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getAsync();
+}
+
+CK_DLL_MFUN(pluginhost_setParallel)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT b = GET_NEXT_INT(ARGS);
+    ph_obj->setParallel(b != 0);
+    RETURN->v_int = b;
+}
+
+CK_DLL_MFUN(pluginhost_getParallel)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getParallel();
 }
 
-CK_DLL_MFUN(pluginhost_name)
+CK_DLL_MFUN(pluginhost_overruns)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getName().c_str(), false);
+    RETURN->v_int = ph_obj->getNumOverruns();
 }
 
-CK_DLL_MFUN(pluginhost_vendor)
+CK_DLL_SFUN(pluginhost_setWorkers)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getVendor().c_str(), false);
+    t_CKINT num = GET_NEXT_INT(ARGS);
+    PluginHost::setNumWorkers((int)num);
+    RETURN->v_int = PluginHost::getNumWorkers();
 }
 
-CK_DLL_MFUN(pluginhost_saveState)
+CK_DLL_SFUN(pluginhost_getWorkers)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    std::string path = GET_NEXT_STRING_SAFE(ARGS);
-    ph_obj->saveState(path);
+    RETURN->v_int = PluginHost::getNumWorkers();
 }
 
-CK_DLL_MFUN(pluginhost_loadState)
+CK_DLL_SFUN(pluginhost_clearPluginCache)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    std::string path = GET_NEXT_STRING_SAFE(ARGS);
-    ph_obj->loadState(path);
+    PluginHost::clearPluginCache();
 }
 
-CK_DLL_MFUN(pluginhost_showEditor)
+CK_DLL_SFUN(pluginhost_scanPlugins)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    ph_obj->showEditor();
+    PluginHost::scanPlugins("");
 }
 
-CK_DLL_MFUN(pluginhost_hideEditor)
+CK_DLL_SFUN(pluginhost_scanPluginsIn)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    ph_obj->hideEditor();
+    std::string directory = GET_NEXT_STRING_SAFE(ARGS);
+    PluginHost::scanPlugins(directory);
 }
 
-CK_DLL_MFUN(pluginhost_asyncEventRunning)
+CK_DLL_SFUN(pluginhost_scanningPlugins)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_int = ph_obj->asyncEventRunning();
+    RETURN->v_int = PluginHost::isScanningPlugins();
 }
 
-CK_DLL_MFUN(pluginhost_waitForAsyncEvents)
+CK_DLL_SFUN(pluginhost_searchPlugins)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    ph_obj->waitForAsyncEvents();
+    std::string query = GET_NEXT_STRING_SAFE(ARGS);
+    RETURN->v_int = PluginHost::searchPlugins(query);
 }
 
-CK_DLL_MFUN(pluginhost_setForceSynchronous)
+CK_DLL_SFUN(pluginhost_foundPluginPath)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    t_CKINT b = GET_NEXT_INT(ARGS);
-    ph_obj->setForceSynchronous(b != 0);
-    RETURN->v_int = b;
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, PluginHost::getFoundPluginPath((int)index).c_str(), false);
 }
 
-CK_DLL_MFUN(pluginhost_getForceSynchronous)
+CK_DLL_SFUN(pluginhost_foundPluginName)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_int = ph_obj->getForceSynchronous();
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, PluginHost::getFoundPluginName((int)index).c_str(), false);
 }
 
-CK_DLL_MFUN(pluginhost_setBlockSize)
+CK_DLL_SFUN(pluginhost_foundPluginVendor)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    t_CKINT size = GET_NEXT_INT(ARGS);
-    ph_obj->setBlockSize(size);
-    RETURN->v_int = size;
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, PluginHost::getFoundPluginVendor((int)index).c_str(), false);
 }
 
-CK_DLL_MFUN(pluginhost_getBlockSize)
+CK_DLL_SFUN(pluginhost_foundPluginCategory)
 {
-    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
-    RETURN->v_int = ph_obj->getBlockSize();
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, PluginHost::getFoundPluginCategory((int)index).c_str(), false);
 }
 
 CK_DLL_MFUN(pluginhost_latency)
@@ -1392,6 +4014,12 @@ CK_DLL_MFUN(pluginhost_latency)
     RETURN->v_int = ph_obj ? ph_obj->getLatency() : 0;
 }
 
+CK_DLL_MFUN(pluginhost_totalLatency)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj ? ph_obj->getTotalLatency() : 0;
+}
+
 CK_DLL_MFUN(pluginhost_setBypass)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
@@ -1627,6 +4255,90 @@ CK_DLL_MFUN(pluginhost_midiMsg)
     if( ph_obj ) ph_obj->midiMsg(b1, b2, b3);
 }
 
+CK_DLL_MFUN(pluginhost_noteOnArray)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * notes = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    t_CKFLOAT vel = GET_NEXT_FLOAT(ARGS);
+    t_CKINT chan = GET_NEXT_INT(ARGS);
+    if( !ph_obj || !notes ) return;
+    for( t_CKINT i = 0; i < API->object->array_int_size(notes); i++ )
+        ph_obj->noteOn(API->object->array_int_get_idx(notes, i), (float)vel, chan);
+}
+
+CK_DLL_MFUN(pluginhost_noteOnArray_default)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * notes = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    t_CKFLOAT vel = GET_NEXT_FLOAT(ARGS);
+    if( !ph_obj || !notes ) return;
+    for( t_CKINT i = 0; i < API->object->array_int_size(notes); i++ )
+        ph_obj->noteOn(API->object->array_int_get_idx(notes, i), (float)vel, 1);
+}
+
+CK_DLL_MFUN(pluginhost_noteOffArray)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * notes = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    t_CKINT chan = GET_NEXT_INT(ARGS);
+    if( !ph_obj || !notes ) return;
+    for( t_CKINT i = 0; i < API->object->array_int_size(notes); i++ )
+        ph_obj->noteOff(API->object->array_int_get_idx(notes, i), chan);
+}
+
+CK_DLL_MFUN(pluginhost_noteOffArray_default)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * notes = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    if( !ph_obj || !notes ) return;
+    for( t_CKINT i = 0; i < API->object->array_int_size(notes); i++ )
+        ph_obj->noteOff(API->object->array_int_get_idx(notes, i), 1);
+}
+
+CK_DLL_MFUN(pluginhost_midiOut)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_object = ph_obj ? (Chuck_Object *) ph_obj->getMidiOutEvent() : NULL;
+}
+
+CK_DLL_MFUN(pluginhost_recvMidiOut)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj ? ph_obj->recvMidiOut() : 0;
+}
+
+CK_DLL_MFUN(pluginhost_midiOutData)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_int = ph_obj ? ph_obj->getMidiOutData(index) : 0;
+}
+
+CK_DLL_MFUN(pluginhost_midiOutTime)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_time = ph_obj ? (t_CKTIME) ph_obj->getMidiOutTime() : 0;
+}
+
+CK_DLL_MFUN(pluginhost_forwardMidi)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_Object * target_obj = GET_NEXT_OBJECT(ARGS);
+    PluginHost * target = target_obj ? (PluginHost *) OBJ_MEMBER_INT(target_obj, pluginhost_data_offset) : NULL;
+    if( ph_obj ) ph_obj->setMidiForward(target, target ? target_obj : NULL);
+}
+
+CK_DLL_MFUN(pluginhost_midiMsgArray)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    Chuck_ArrayInt * bytes = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    if( !ph_obj || !bytes ) return;
+    // a trailing incomplete message is ignored
+    const t_CKINT size = API->object->array_int_size(bytes);
+    for( t_CKINT i = 0; i + 2 < size; i += 3 )
+        ph_obj->midiMsg(API->object->array_int_get_idx(bytes, i), API->object->array_int_get_idx(bytes, i + 1), API->object->array_int_get_idx(bytes, i + 2));
+}
+
 CK_DLL_MFUN(pluginhost_pitchBend)
 {
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
@@ -1691,3 +4403,292 @@ CK_DLL_MFUN(pluginhost_toggleQWERTYMidiInput)
     PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
     if( ph_obj ) ph_obj->toggleQWERTYMidiInput();
 }
+
+//-----------------------------------------------------------------------------
+// PluginChain functions
+//-----------------------------------------------------------------------------
+CK_DLL_MFUN(pluginchain_add)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->addStage(path);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginchain_insert)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->insertStage((int)stage, path);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginchain_load)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->replaceStage((int)stage, path);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginchain_remove)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    ph_obj->removeStage((int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_move)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT from = GET_NEXT_INT(ARGS);
+    t_CKINT to = GET_NEXT_INT(ARGS);
+    ph_obj->moveStage((int)from, (int)to);
+}
+
+CK_DLL_MFUN(pluginchain_size)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    RETURN->v_int = ph_obj->getNumStages();
+}
+
+CK_DLL_MFUN(pluginchain_setParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    t_CKFLOAT val = GET_NEXT_FLOAT(ARGS);
+    RETURN->v_float = ph_obj->setParam(index, (float)val, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_getParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_float = ph_obj->getParam(index, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_getParamName)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamName(index, (int)stage).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginchain_getParamDisplay)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getParamDisplay(index, (int)stage).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginchain_numParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    RETURN->v_int = ph_obj->getNumParams((int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_findParam)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    std::string name = GET_NEXT_STRING_SAFE(ARGS);
+    RETURN->v_int = ph_obj->findParam(name, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_setParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    Chuck_ArrayInt * indices = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->setParams(indices, values, false, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_setParamsIfChanged)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    Chuck_ArrayInt * indices = (Chuck_ArrayInt *) GET_NEXT_OBJECT(ARGS);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->setParams(indices, values, true, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_getParams)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    Chuck_ArrayFloat * values = (Chuck_ArrayFloat *) GET_NEXT_OBJECT(ARGS);
+    RETURN->v_int = ph_obj->getParams(values, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_program)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT index = GET_NEXT_INT(ARGS);
+    ph_obj->setCurrentProgram((int)index, (int)stage);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginchain_name)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    RETURN->v_string = (Chuck_String *)API->object->create_string(VM, ph_obj->getName((int)stage).c_str(), false);
+}
+
+CK_DLL_MFUN(pluginchain_saveState)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->saveState(path, (int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_loadState)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    std::string path = GET_NEXT_STRING_SAFE(ARGS);
+    ph_obj->loadState(path, (int)stage);
+    RETURN->v_object = ph_obj->getLastOperationObject();
+}
+
+CK_DLL_MFUN(pluginchain_showEditor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    ph_obj->showEditor((int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_hideEditor)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    ph_obj->hideEditor((int)stage);
+}
+
+CK_DLL_MFUN(pluginchain_setBypass)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    t_CKINT b = GET_NEXT_INT(ARGS);
+    ph_obj->setBypass(b != 0, (int)stage);
+    RETURN->v_int = b;
+}
+
+CK_DLL_MFUN(pluginchain_getBypass)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT stage = GET_NEXT_INT(ARGS);
+    RETURN->v_int = ph_obj->getBypass((int)stage);
+}
+
+//-----------------------------------------------------------------------------
+// PluginGraph functions
+//-----------------------------------------------------------------------------
+CK_DLL_CTOR(plugingraph_ctor)
+{
+    // the host itself was created by the PluginHost constructor
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    if( ph_obj ) ph_obj->enableGraph();
+}
+
+CK_DLL_MFUN(plugingraph_connect)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT from = GET_NEXT_INT(ARGS);
+    t_CKINT to = GET_NEXT_INT(ARGS);
+    ph_obj->connect((int)from, (int)to, false);
+}
+
+CK_DLL_MFUN(plugingraph_connectMidi)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT from = GET_NEXT_INT(ARGS);
+    t_CKINT to = GET_NEXT_INT(ARGS);
+    ph_obj->connect((int)from, (int)to, true);
+}
+
+CK_DLL_MFUN(plugingraph_disconnect)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT from = GET_NEXT_INT(ARGS);
+    t_CKINT to = GET_NEXT_INT(ARGS);
+    ph_obj->disconnect((int)from, (int)to, false);
+}
+
+CK_DLL_MFUN(plugingraph_disconnectMidi)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    t_CKINT from = GET_NEXT_INT(ARGS);
+    t_CKINT to = GET_NEXT_INT(ARGS);
+    ph_obj->disconnect((int)from, (int)to, true);
+}
+
+CK_DLL_MFUN(plugingraph_disconnectAll)
+{
+    PluginHost * ph_obj = (PluginHost *) OBJ_MEMBER_INT(SELF, pluginhost_data_offset);
+    ph_obj->disconnectAll();
+}
+
+
+//-----------------------------------------------------------------------------
+// PluginOp functions
+//-----------------------------------------------------------------------------
+// the operation behind a PluginOp, null for one created by a shred
+static AsyncOperation * pluginop_get(Chuck_Object * obj)
+{
+    auto * operation = (std::shared_ptr<AsyncOperation> *) OBJ_MEMBER_INT(obj, pluginop_data_offset);
+    return operation ? operation->get() : NULL;
+}
+
+CK_DLL_DTOR(pluginop_dtor)
+{
+    delete (std::shared_ptr<AsyncOperation> *) OBJ_MEMBER_INT(SELF, pluginop_data_offset);
+    OBJ_MEMBER_INT(SELF, pluginop_data_offset) = 0;
+}
+
+CK_DLL_MFUN(pluginop_id)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    RETURN->v_int = op ? op->getId() : 0;
+}
+
+CK_DLL_MFUN(pluginop_status)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    RETURN->v_int = op ? op->getStatus() : AsyncOperation::done;
+}
+
+CK_DLL_MFUN(pluginop_done)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    RETURN->v_int = op ? op->isFinished() : 1;
+}
+
+CK_DLL_MFUN(pluginop_ok)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    RETURN->v_int = op ? op->getStatus() == AsyncOperation::done : 1;
+}
+
+CK_DLL_MFUN(pluginop_error)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    std::string error = op && op->getStatus() == AsyncOperation::failed ? op->getError() : "";
+    RETURN->v_string = (Chuck_String *) API->object->create_string(VM, error.c_str(), false);
+}
+
+CK_DLL_MFUN(pluginop_cancel)
+{
+    AsyncOperation * op = pluginop_get(SELF);
+    RETURN->v_int = op ? op->cancel() : 0;
+}
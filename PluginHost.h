@@ -8,13 +8,33 @@
 
 #include "PluginEditorWindow.h"
 #include "CircularBuffer.h"
+#include "AsyncProcessor.h"
+#include "PluginChain.h"
+#include "PluginGraph.h"
+#include "MidiEventQueue.h"
+#include "ParameterQueue.h"
+#include "ParameterAutomation.h"
+#include "ParameterTable.h"
+#include "ParameterChanges.h"
+#include "ModulationInput.h"
+#include "PluginCatalog.h"
+#include "PluginScanner.h"
+#include "PluginPool.h"
+#include "AsyncOperation.h"
+#include "OperationPool.h"
 #include "PlayHead.h"
 #include "QWERTYMidiWindow.h"
+#include "Utilities.h"
 
 #include <string>
 #include <memory>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 //-----------------------------------------------------------------------------
 // PluginHost
@@ -26,7 +46,8 @@ public:
     //-------------------------------------------------------------------------
     // constructor/destructor
     //-------------------------------------------------------------------------
-    PluginHost( t_CKFLOAT fs );
+    // vm / api are used to read ChucK's current time, which MIDI events are stamped with
+    PluginHost( t_CKFLOAT fs, Chuck_VM * vm, CK_DL_API api );
     ~PluginHost();
 
     //-------------------------------------------------------------------------
@@ -36,30 +57,109 @@ public:
 
     //-------------------------------------------------------------------------
     // parameter accessors
+    // (stage selects the plugin in the chain, a plain PluginHost only has stage 0)
     //-------------------------------------------------------------------------
-    int getNumParams();
-    int getNumNonMidiParams();
-    std::string getParamName(int index);
-    float getParam(int index);
-    float setParam(int index, float val);
-    int findParam(const std::string& name);
-    std::string getParamLabel(int index);
-    std::string getParamDisplay(int index);
+    int getNumParams(int stage = 0);
+    int getNumNonMidiParams(int stage = 0);
+    std::string getParamName(int index, int stage = 0);
+    float getParam(int index, int stage = 0);
+    float setParam(int index, float val, int stage = 0);
+    int findParam(const std::string& name, int stage = 0);
+    std::string getParamLabel(int index, int stage = 0);
+    std::string getParamDisplay(int index, int stage = 0);
+    // stable parameter ID from the plugin format ("" if it has none) and lookup by it
+    std::string getParamId(int index, int stage = 0);
+    int findParamById(const std::string& id, int stage = 0);
+    // index of the n-th parameter that isn't a MIDI CC proxy, -1 if out of range
+    int getNonMidiParam(int n, int stage = 0);
+    float getParamDefault(int index, int stage = 0);
+    int getParamNumSteps(int index, int stage = 0);
+    // set / read many parameters with a single lookup of the plugin, invalid indices are skipped
+    // with onlyIfChanged values equal to the parameter's current one aren't sent, returns the number of values set
+    int setParams(const int* indices, const float* values, int count, bool onlyIfChanged, int stage = 0);
+    // the values of all parameters, in index order
+    void getParams(std::vector<float>& values, int stage = 0);
+    // same for ChucK arrays, getParams replaces the array's contents and returns the number of values
+    int setParams(Chuck_ArrayInt* indices, Chuck_ArrayFloat* values, bool onlyIfChanged, int stage = 0);
+    int getParams(Chuck_ArrayFloat* values, int stage = 0);
+
+    //-------------------------------------------------------------------------
+    // parameter automation (evaluated by the audio thread, see ParameterAutomation)
+    //-------------------------------------------------------------------------
+    // ramp from the current value to target over length samples, or with append from where the parameter's
+    // current ramp ends (see ParameterAutomation::maxSegments)
+    void rampParam(int index, float target, double length, bool exponential, int stage = 0, bool append = false);
+    // oscillate around center by depth (shape is a ParameterAutomation::Shape, frequency in Hz)
+    void setParamLFO(int index, int shape, float frequency, float center, float depth, int stage = 0);
+    // stop the ramp / LFO on a parameter (-1 for all), the parameter keeps its current value
+    void stopParamAutomation(int index, int stage = 0);
+    // drive a parameter from a modulation input: center + depth * input, clipped to 0-1
+    void setModulation(int input, int index, float center, float depth, int stage = 0);
+    // stop driving parameters from a modulation input (-1 for all)
+    void clearModulation(int input);
+    // take the modulation inputs from a PluginMod (null to stop, the inputs are then silent)
+    // object is the PluginMod's ChucK object, which is kept alive while it's used
+    void setModulationInput(ModulationInput * input, Chuck_Object * object);
 
     //-------------------------------------------------------------------------
     // metadata
     //-------------------------------------------------------------------------
-    std::string getName() const;
-    std::string getVendor() const;
+    std::string getName(int stage = 0) const;
+    std::string getVendor(int stage = 0) const;
 
     //-------------------------------------------------------------------------
     // load / state
     //-------------------------------------------------------------------------
+    // replaces the whole chain with a single plugin
     void loadPlugin(const std::string& path);
-    void showEditor();
-    void hideEditor();
-    void saveState(const std::string& path);
-    void loadState(const std::string& path);
+    void showEditor(int stage = 0);
+    void hideEditor(int stage = 0);
+    void saveState(const std::string& path, int stage = 0);
+    void loadState(const std::string& path, int stage = 0);
+    // create and prepare count instances of a plugin in the background, loading it then takes one instantly
+    void preload(const std::string& path, int count);
+    int getNumPreloaded(const std::string& path) const;
+    void clearPreloaded(const std::string& path);
+    // replace the chain with a new instance of a stage of source, in the same state
+    // sourceObject is source's ChucK object, which is kept alive until the clone has finished
+    void clonePlugin(PluginHost& source, Chuck_Object * sourceObject, int sourceStage = 0);
+
+    //-------------------------------------------------------------------------
+    // plugin discovery (shared by all hosts, see PluginCatalog / PluginScanner)
+    //-------------------------------------------------------------------------
+    // scan the standard plugin directories, and directory if not empty, in the background
+    static void scanPlugins(const std::string& directory);
+    static bool isScanningPlugins();
+    // search the known plugins by name, vendor, category or format, returns the number of matches
+    static int searchPlugins(const std::string& query);
+    // a match of the last search, "" if out of range
+    static std::string getFoundPluginPath(int index);
+    static std::string getFoundPluginName(int index);
+    static std::string getFoundPluginVendor(int index);
+    static std::string getFoundPluginCategory(int index);
+    static void clearPluginCache();
+
+    //-------------------------------------------------------------------------
+    // plugin chain
+    //-------------------------------------------------------------------------
+    int getNumStages() const;
+    void addStage(const std::string& path);
+    void insertStage(int index, const std::string& path);
+    void replaceStage(int index, const std::string& path);
+    void removeStage(int index);
+    void moveStage(int from, int to);
+    // index of the stage running the given processor, -1 if none (message thread)
+    int findStage(const juce::AudioProcessor* processor) const;
+
+    //-------------------------------------------------------------------------
+    // plugin graph
+    // (stages are the nodes, see PluginGraph::inputNode/outputNode for the graph's own input and output)
+    //-------------------------------------------------------------------------
+    // route the stages through connections instead of running them as a chain, before loading anything
+    void enableGraph();
+    void connect(int source, int destination, bool midi);
+    void disconnect(int source, int destination, bool midi);
+    void disconnectAll();
 
     //-------------------------------------------------------------------------
     // async / sync
@@ -68,15 +168,39 @@ public:
     void waitForAsyncEvents(int timeoutMs = -1) const;
     void setForceSynchronous(bool b);
     bool getForceSynchronous() const;
+    // The PluginOp object of the operation started last (or of a given one), broadcast once it has
+    // finished. The host keeps a reference until then. Broadcasts happen on the tick, so the host has to be connected.
+    Chuck_Object * getLastOperationObject() { return getOperationObject(m_lastOperation); }
+    Chuck_Object * getOperationObject(std::shared_ptr<AsyncOperation> operation);
+    // number of program, block size, editor and loadState calls merged into a later one of the same kind
+    int getNumMergedCommands() const { return m_numMergedCommands.load(); }
 
     //-------------------------------------------------------------------------
     // processing config
     //-------------------------------------------------------------------------
     void setBlockSize(int size);
     int getBlockSize() const;
+    void setMaxBlockSize(int size);
+    int getMaxBlockSize() const;
+    void setDirectProcessing(bool b);
+    bool getDirectProcessing() const;
+    void setMinSubBlockSize(int size);
+    int getMinSubBlockSize() const;
+    void setCrossfade(double samples);
+    double getCrossfade() const;
+    void setAsync(bool b);
+    bool getAsync() const;
+    void setParallel(bool b);
+    bool getParallel() const;
+    // number of blocks skipped in async / parallel mode because the worker was still on the previous one
+    int getNumOverruns() const { return m_numOverruns.load(); }
+    // worker count of the shared pool, its threads are started / stopped later on the message thread
+    static void setNumWorkers(int num);
+    static int getNumWorkers();
     int getLatency() const;
-    void setBypass(bool b);
-    bool getBypass() const;
+    int getTotalLatency() const;
+    void setBypass(bool b, int stage = 0);
+    bool getBypass(int stage = 0) const;
     void reset();
     int getNumInputs() const;
     int getNumOutputs() const;
@@ -86,10 +210,10 @@ public:
     //-------------------------------------------------------------------------
     // program functions
     //-------------------------------------------------------------------------
-    int getNumPrograms();
-    int getCurrentProgram();
-    void setCurrentProgram(int index);
-    std::string getProgramName(int index);
+    int getNumPrograms(int stage = 0);
+    int getCurrentProgram(int stage = 0);
+    void setCurrentProgram(int index, int stage = 0);
+    std::string getProgramName(int index, int stage = 0);
 
     //-------------------------------------------------------------------------
     // playHead accessors
@@ -125,78 +249,521 @@ public:
     void controlChange(int controlNumber, int value, int channel);
     void midiMsg(int byte1, int byte2, int byte3);
     void addMidiEvent(const juce::MidiMessage& msg);
+
+    //-------------------------------------------------------------------------
+    // MIDI output
+    //-------------------------------------------------------------------------
+    // event broadcast after every block the plugin output MIDI in, starts the collection of output messages
+    Chuck_Event * getMidiOutEvent();
+    // take the next output message, false if there is none
+    bool recvMidiOut();
+    // the message taken by recvMidiOut(): its bytes (0 past the end) and the ChucK time of the sample it belongs to
+    int getMidiOutData(int index) const;
+    int64_t getMidiOutTime() const;
+    // Send the output MIDI straight to another host's MIDI input (null to stop)
+    // object is the target's ChucK object, which is kept alive while forwarding
+    void setMidiForward(PluginHost * target, Chuck_Object * object);
+
+    //-------------------------------------------------------------------------
+    // parameter change notifications (changes the plugins make themselves, see ParameterChanges)
+    //-------------------------------------------------------------------------
+    // event broadcast from the tick after a plugin changed parameters
+    Chuck_Event * getParamChangedEvent();
+    // take the next changed parameter of any stage, false if there is none
+    bool recvParamChange();
+    // the change taken by recvParamChange(): stage, parameter index and latest value
+    int getParamChangeStage() const { return m_paramChange.stage; }
+    int getParamChangeIndex() const { return m_paramChange.index; }
+    float getParamChangeValue() const { return m_paramChange.value; }
     void addQWERTYMidiInput();
     void removeQWERTYMidiInput();
     void toggleQWERTYMidiInput();
 
     // for now used fixed number of channels
     static constexpr int maxChannels = 8;
+    // modulation inputs which can be mapped to parameters, see setModulationInput()
+    static constexpr int maxModInputs = ModulationInput::numInputs;
 
 private:
 
-    // plugin format manager
-    juce::AudioPluginFormatManager m_formatManager;
-    // plugin list
-    juce::KnownPluginList m_knownPluginList;
+    //-------------------------------------------------------------------------
+    // processing config
+    //-------------------------------------------------------------------------
+    // Everything tick() needs to render a block. A config is built (and its plugin prepared)
+    // on the message thread, then handed to the audio thread with an atomic pointer swap.
+    // After publishing it is never modified, except for the audio thread rendering into renderBuffer.
+    struct ProcessingConfig
+    {
+        ProcessingConfig(int numChannels, int numRenderChannels, int blockSize, int maxBlockSize, bool directProcessing)
+            : blockSize(blockSize), maxBlockSize(maxBlockSize), directProcessing(directProcessing), numChannels(numChannels),
+              renderBuffer(numRenderChannels, directProcessing ? maxBlockSize : blockSize),
+              inputBuffer(numChannels, maxBlockSize + 1),
+              outputBuffer(numChannels, maxBlockSize + 1),
+              modInputBuffer(maxModInputs, maxBlockSize + 1),
+              modRenderBuffer(maxModInputs, maxBlockSize)
+        {
+            renderBuffer.clear();
+            modRenderBuffer.clear();
+        }
+
+        // prepared plugin chain (may be empty), shared so that a retired config keeps the plugins alive
+        PluginList plugins;
+        // plugin block size
+        int blockSize = 16;
+        // the block size the plugin was prepared for - larger ticks are split into chunks of at most this
+        int maxBlockSize = defaultMaxBlockSize;
+        // process whatever number of frames ChucK ticks with directly, without accumulating blocks
+        bool directProcessing = false;
+        // number of channels exchanged with ChucK, resolved from the plugin's bus layout (<= maxChannels)
+        int numChannels = maxChannels;
+        // audio render buffer (all the channels the plugins want x blockSize, or maxBlockSize when processing directly)
+        // channels beyond numChannels (e.g. sidechains) are fed silence
+        juce::AudioBuffer<float> renderBuffer;
+        // input accumulation buffer (numChannels)
+        CircularBuffer inputBuffer;
+        // output buffer (numChannels)
+        CircularBuffer outputBuffer;
+        // worker running the plugin one block ahead, null when processing inline
+        std::shared_ptr<AsyncProcessor> asyncProcessor;
+        // compiled routing between the plugins in graph mode, null when they run as a chain
+        std::unique_ptr<PluginGraph> graph;
+
+        // modulation inputs mapped to parameters of this config's plugins
+        struct ModTarget
+        {
+            int input = 0;
+            juce::AudioProcessorParameter* param = nullptr;
+            float center = 0.0f;
+            float depth = 0.0f;
+        };
+        std::vector<ModTarget> modTargets;
+        // modulation input accumulation, and the block being rendered (only used with modTargets)
+        CircularBuffer modInputBuffer;
+        juce::AudioBuffer<float> modRenderBuffer;
+    };
+
+    // build a new config for the given plugin chain from the current settings, creating an async worker if needed (message thread)
+    std::unique_ptr<ProcessingConfig> createConfig(PluginList plugins);
+    // hand a config over to the audio thread, replacing any config which hasn't been picked up yet (message thread)
+    void publishConfig(std::unique_ptr<ProcessingConfig> config);
+    // delete the configs the audio thread has retired, if any (message thread, regularly from ConfigReclaimer)
+    void reclaimConfigs();
+    // swap in the latest published config and return the one to use for this tick (audio thread)
+    ProcessingConfig& acquireConfig();
+    // hand a config the audio thread is done with to the message thread for deletion, false if there's no room (audio thread)
+    bool retireConfig(ProcessingConfig* config);
+    int getNumFreeRetiredSlots() const;
+    // true if the audio thread may run old alongside next while fading from one to the other (audio thread)
+    static bool canCrossfade(const ProcessingConfig& old, const ProcessingConfig& next);
+    // run the chain being faded out on a copy of the block's input in config.renderBuffer (audio thread)
+    void renderFadingConfig(const ProcessingConfig& config, int numSamples);
+    // crossfade the output of the chain being faded out into config.renderBuffer (audio thread)
+    void mixFadingConfig(ProcessingConfig& config, int numSamples);
+    // run the plugin chain on config.renderBuffer, with the MIDI due in the block starting at blockTime (audio thread)
+    void renderBlock(ProcessingConfig& config, int numSamples, int64_t blockTime);
+    // process interleaved frames straight through the plugin, in chunks of at most the render buffer size (audio thread)
+    // tickTime is the ChucK time of the first frame
+    void processDirect(ProcessingConfig& config, const SAMPLE* in, SAMPLE* out, int nframes, int64_t tickTime);
+    // ChucK's current time in whole samples
+    int64_t getNow() const;
+    // hand the block's output MIDI to ChucK and the forwarding target (audio thread)
+    void deliverMidiOut(int64_t blockTime);
+    // run the plugins on numSamples of config.renderBuffer, split wherever a queued parameter change is due (audio thread)
+    void processWithAutomation(ProcessingConfig& config, int numSamples, int64_t blockTime);
+    // run the plugins on a range of config.renderBuffer (audio thread)
+    void processRange(ProcessingConfig& config, int start, int numSamples, juce::MidiBuffer& midi);
+    // apply the queued parameter changes made before time to the config's plugins (audio thread)
+    void applyParameterChanges(ProcessingConfig& config, int64_t time);
+    // set a parameter at the current ChucK time, through the audio thread while we're being ticked (shred)
+    void setParamNow(juce::AudioProcessor* plugin, juce::AudioProcessorParameter* param, int index, float val, int64_t now);
+    // queue a ramp / LFO change for a stage's plugin, dropped (and reported) while we're not being ticked (shred)
+    void queueAutomation(ParameterQueue::Change change, int stage);
+    // set the mapped parameters from the modulation inputs at a sample of the block being rendered (audio thread)
+    void applyModulation(ProcessingConfig& config, int sample);
+    // the latest frame of the PluginMod's inputs, silent without one (audio thread)
+    const float* getModulationFrame() const;
+    // wait until none of the async workers is running a block (message thread)
+    void waitForAsyncProcessors();
+    // take the plugins away from the audio thread while func runs, e.g. to re-prepare them (message thread)
+    void runWithPluginDetached(const std::function<void()>& func);
+
+    // a plugin in the chain, with its editor window
+    struct Stage
+    {
+        std::shared_ptr<juce::AudioPluginInstance> plugin;
+        // declared after the plugin so that it's destroyed first
+        std::unique_ptr<PluginEditorWindow> editor;
+        // parameter metadata, built by stagesChanged and replaced when the plugin's parameters change
+        std::shared_ptr<const ParameterTable> params;
+        // parameter changes reported by the plugin, replaced along with params
+        std::shared_ptr<ParameterChanges> changes;
+        // what the plugin is filed under in the PluginPool (see PluginPool::getKey), for clone()
+        std::string poolKey;
+    };
+    // what the shreds see of a stage, see m_publishedStages
+    struct StageView
+    {
+        std::shared_ptr<juce::AudioPluginInstance> plugin;
+        std::shared_ptr<const ParameterTable> params;
+        std::shared_ptr<ParameterChanges> changes;
+    };
+    using StageViews = std::vector<StageView>;
+
+    // see below
+    struct AsyncEventContext;
+
+    // create, set up and prepare a plugin (or take a preloaded one), then hand its stage to install on the message thread
+    void loadPlugin(const std::string& path, std::function<void(Stage)> install);
+    // install callback of loadPlugin(path), replaces the whole chain (message thread)
+    void replaceChain(Stage stage);
+    // description of the first plugin in a file, from the catalog (message thread)
+    bool findPluginDescription(const juce::File& file, juce::PluginDescription& description, AsyncEventContext& context);
+    // create an instance, set up its buses and prepare it, then hand it to done as a step of context's operation (message thread)
+    void createPluginInstance(const juce::PluginDescription& description, std::shared_ptr<AsyncEventContext> context,
+                              std::function<void(PluginPool::Instance)> done);
+    // make a created or preloaded instance ready for this host and hand it to install as a stage, filed under poolKey (message thread)
+    void installPlugin(PluginPool::Instance instance, const std::string& poolKey, const std::function<void(Stage)>& install);
+    // the latest published snapshot of the stages (any thread)
+    std::shared_ptr<const StageViews> getStageViews() const;
+    // plugin of the given stage in the published snapshot, null if out of range (any thread)
+    std::shared_ptr<juce::AudioPluginInstance> getPlugin(int stage) const;
+    // parameter metadata of the given stage in the published snapshot, null if out of range (any thread)
+    std::shared_ptr<const ParameterTable> getParameterTable(int stage) const;
+    std::shared_ptr<ParameterChanges> getParameterChanges(int stage) const;
+    // copy m_stages into a new snapshot for the other threads (message thread)
+    void publishStages();
+    // the plugins of all stages, in order
+    PluginList getStagePlugins() const;
+    // refresh the channel counts and hand the current chain to the audio thread (message thread)
+    void stagesChanged();
+    // listen for latency and parameter changes on the current stages only (message thread)
+    void updatePluginListeners();
+    // (re)read the parameter metadata of the stages, all of them or only the ones that have none yet (message thread)
+    void updateParameterTables(bool rebuildAll);
+    // renumber the graph connections after stages moved, map returns a negative index for a removed stage (message thread)
+    void remapConnections(const std::function<int(int)>& map);
+    // negotiate the bus layout of a newly created plugin, must be called before it is prepared (message thread)
+    void configureBuses(juce::AudioPluginInstance& instance);
+
+    // plugin formats and scan results shared by all hosts
+    std::shared_ptr<PluginCatalog> m_catalog;
+    // preloaded instances shared by all hosts
+    std::shared_ptr<PluginPool> m_pool;
     // playhead
     PlayHead m_playHead;
-    // plugin instance
-    std::unique_ptr<juce::AudioPluginInstance> m_plugin;
-    // plugin editor window
-    std::unique_ptr<PluginEditorWindow> m_editor;
-    // audio render buffer
-    juce::AudioBuffer<float> m_renderBuffer;
+    // set by the stages' ParameterChanges when a plugin changed a parameter, the tick broadcasts m_paramChangedEvent
+    // (shared with their listeners, which may outlive the host)
+    std::shared_ptr<std::atomic<bool>> m_paramsChanged = std::make_shared<std::atomic<bool>>(false);
+    // plugin chain, a plain PluginHost has at most one stage - only touched by the message thread, which edits it in place
+    std::vector<Stage> m_stages;
+    // immutable copy of m_stages for the shreds, replaced (std::atomic_store) after every edit by publishStages()
+    // The audio thread uses the plugins in its config instead.
+    std::shared_ptr<const StageViews> m_publishedStages;
     // keyboard state
     juce::MidiKeyboardState m_keyboardState;
     // qwerty window
     std::unique_ptr<QWERTYMidiWindow> m_qwertyWindow;
-    // accumulated MIDI buffer which will be used as input
-    juce::MidiBuffer m_inputMidi;
+    // MIDI sent by the shreds, waiting for the block it falls into
+    MidiEventQueue m_midiQueue;
+    // MIDI output of the plugins, waiting to be read by a shred (only collected once midiOut() was called)
+    MidiEventQueue m_midiOutQueue;
+    bool m_midiOutEnabled = false;
+    MidiEventQueue::Event m_midiOutMessage;
+    Chuck_Event * m_midiOutEvent = nullptr;
+    // lets the VM know about the broadcast from the tick
+    CBufferSimple * m_eventBuffer = nullptr;
+    // parameter change notifications
+    bool m_paramChangedEnabled = false;
+    Chuck_Event * m_paramChangedEvent = nullptr;
+    struct
+    {
+        int stage = -1;
+        int index = -1;
+        float value = 0.0f;
+    } m_paramChange;
+    // parameter changes made by the shreds, waiting for the sample they were made at
+    ParameterQueue m_parameterQueue;
+    // ramps and LFOs running on the parameters (audio thread)
+    ParameterAutomation m_automation;
+    // scratch space of the batch parameter functions, reused so they don't allocate every call (shred)
+    std::vector<int> m_batchIndices;
+    std::vector<float> m_batchValues;
+    // modulation input mappings, resolved to parameters when a config is built (message thread)
+    struct ModMapping
+    {
+        int input = 0;
+        std::weak_ptr<juce::AudioPluginInstance> plugin;
+        int index = 0;
+        float center = 0.0f;
+        float depth = 0.0f;
+    };
+    std::vector<ModMapping> m_modMappings;
+    // PluginMod the modulation inputs are read from, with its ChucK object holding a reference (VM thread)
+    ModulationInput * m_modInput = nullptr;
+    Chuck_Object * m_modInputObject = nullptr;
+    // MIDI of the sub-block being processed, and the output of the sub-blocks so far
+    juce::MidiBuffer m_subBlockMidi;
+    juce::MidiBuffer m_splitOutputMidi;
+    // ChucK time just past the last frame ticked, shreds running later than that mean we're not being ticked
+    int64_t m_tickEndTime = 0;
+    // blocks are only split at least this many samples apart, closer changes wait for the next split
+    std::atomic<int> m_minSubBlockSize { defaultMinSubBlockSize };
+    static constexpr int defaultMinSubBlockSize = 16;
+    // host the output MIDI is forwarded to, with its ChucK object holding a reference
+    PluginHost * m_midiForward = nullptr;
+    Chuck_Object * m_midiForwardObject = nullptr;
     // processed MIDI buffer which will store the midi output
     juce::MidiBuffer m_outputMidi;
 
-    // brute force synchronization - use sparingly
-    // currently used for protecting critical audio processing code, such as resizing buffers
-    juce::SpinLock m_audioLock;
+    // config currently used by tick() - only ever touched by the audio thread
+    ProcessingConfig* m_audioConfig = nullptr;
+    // config published by the message thread, waiting to be picked up by the audio thread
+    std::atomic<ProcessingConfig*> m_pendingConfig { nullptr };
+    // configs the audio thread has stopped using, waiting to be deleted by the message thread
+    // (only the audio thread fills a slot, only the message thread empties one)
+    static constexpr int maxRetiredConfigs = 4;
+    std::array<std::atomic<ProcessingConfig*>, maxRetiredConfigs> m_retiredConfigs {};
+
+    // Chugin-wide timer on the message thread which reclaims the retired configs of every host, so a
+    // config (and the plugins it holds) is deleted soon after it's retired, not only on the next publish.
+    // Also lets go of the ParameterChanges listeners kept for plugins which have since been deleted.
+    // Hosts add themselves on construction and remove themselves before destruction (VM thread),
+    // the lock keeps a host from going away during a callback.
+    class ConfigReclaimer : private juce::Timer
+    {
+    public:
+        static ConfigReclaimer& getInstance()
+        {
+            static ConfigReclaimer instance;
+            return instance;
+        }
+
+        void add(PluginHost* host)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hosts.push_back(host);
+            if (m_hosts.size() == 1)
+                startTimer(intervalMs);
+        }
+
+        void remove(PluginHost* host)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hosts.erase(std::remove(m_hosts.begin(), m_hosts.end(), host), m_hosts.end());
+            if (m_hosts.empty())
+                stopTimer();
+        }
+
+    private:
+        static constexpr int intervalMs = 100;
+
+        void timerCallback() override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto* host : m_hosts)
+                host->reclaimConfigs();
+            ParameterChanges::reclaimRetired();
+        }
+
+        std::mutex m_mutex;
+        std::vector<PluginHost*> m_hosts;
+    };
+    // Config replaced by m_audioConfig which is still run alongside it while crossfading to the
+    // new plugins - only ever touched by the audio thread. Retired once the fade is done.
+    ProcessingConfig* m_fadeConfig = nullptr;
+    int m_fadePosition = 0;
+    int m_fadeLength = 0;
+    // MIDI buffer of the chain being faded out, which gets no new events
+    juce::MidiBuffer m_fadeMidi;
+    // length of the crossfade when the plugins are replaced, in samples (0 swaps immediately)
+    std::atomic<int> m_crossfade { 0 };
+    // upper limit for the crossfade, in seconds
+    static constexpr double maxCrossfadeSeconds = 10.0;
+    // true while the audio thread is inside tick()
+    std::atomic<bool> m_audioThreadProcessing { false };
 
     double m_srate;
+    Chuck_VM * m_vm = nullptr;
+    CK_DL_API m_api = nullptr;
     // Plugin block size - since chugins are generally sample by sample, samples will have to accumulate,
     // meaning a delay will be introduced. This is a tradeoff between delay and processing speed.
     // Plugins are optimized for larger block sizes, generally.
     // If the block size is equivilent to the number of frames in tick(), then the the audio
     // will be passed directly to the plugin (bypassing the delay and accumulation).
-    int m_blockSize = 16;
-    // maximum plugin block size
-    static constexpr int maxBufferSize = 256;
-    // input accumulation buffer
-    CircularBuffer m_inputBuffer;
-    // output buffer
-    CircularBuffer m_outputBuffer;
-
-    // context for tracking async events
+    // This is the requested value, the audio thread uses the block size of its config.
+    std::atomic<int> m_blockSize { 16 };
+    // maximum plugin block size - plugins are prepared for this so that block size changes never re-prepare
+    std::atomic<int> m_maxBlockSize { defaultMaxBlockSize };
+    static constexpr int defaultMaxBlockSize = 256;
+    // upper limit for the maximum block size (big blocks are mostly useful for offline rendering)
+    static constexpr int maxBlockSizeLimit = 16384;
+    // see ProcessingConfig::directProcessing
+    std::atomic<bool> m_directProcessing { false };
+    // Run the plugin on a worker thread one block ahead (adds one block of latency).
+    // Only applies to fixed size blocks, direct processing always runs inline.
+    std::atomic<bool> m_async { false };
+    // blocks skipped because the async worker didn't finish in time (audio thread)
+    std::atomic<int> m_numOverruns { 0 };
+    // Like m_async, but on the worker pool shared by all instances (see ParallelScheduler)
+    std::atomic<bool> m_parallel { false };
+    // stages are routed through m_connections rather than run as a chain
+    std::atomic<bool> m_graphMode { false };
+    // graph connections between stages (message thread)
+    std::vector<PluginGraph::Connection> m_connections;
+    // worker shared by the configs while async / parallel processing is on (message thread view)
+    std::shared_ptr<AsyncProcessor> m_asyncProcessor;
+    // every worker handed out to a config, which may still be alive in an older config
+    std::vector<std::weak_ptr<AsyncProcessor>> m_asyncProcessors;
+    // channel counts of the chain (first stage's inputs, last stage's outputs), resolved when the chain changes
+    std::atomic<int> m_numInputChannels { 0 };
+    std::atomic<int> m_numOutputChannels { 0 };
+    // latency of the plugins (chain sum or longest graph path), and including the host's block buffering,
+    // resolved whenever a config is built
+    std::atomic<int> m_latency { 0 };
+    std::atomic<int> m_totalLatency { 0 };
+
+    // rebuilds the config when a plugin reports a new latency, so the graph gets recompensated, and the
+    // parameter tables when a plugin's parameter layout changes (plugins may report either from any thread,
+    // the rebuild happens on the message thread)
+    struct PluginListener : juce::AudioProcessorListener, juce::AsyncUpdater
+    {
+        explicit PluginListener(PluginHost& host) : m_host(host) {}
+
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override {}
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details) override
+        {
+            if (details.latencyChanged)
+                m_latencyChanged = true;
+            if (details.parameterInfoChanged)
+                m_parameterInfoChanged = true;
+            if (details.latencyChanged || details.parameterInfoChanged)
+                triggerAsyncUpdate();
+        }
+        void handleAsyncUpdate() override
+        {
+            if (m_parameterInfoChanged.exchange(false))
+                m_host.updateParameterTables(true);
+            if (m_latencyChanged.exchange(false))
+                m_host.publishConfig(m_host.createConfig(m_host.getStagePlugins()));
+        }
+
+        PluginHost& m_host;
+        std::atomic<bool> m_latencyChanged { false };
+        std::atomic<bool> m_parameterInfoChanged { false };
+    };
+    PluginListener m_pluginListener { *this };
+    // plugins m_pluginListener is registered with
+    std::vector<std::weak_ptr<juce::AudioPluginInstance>> m_listenedPlugins;
+
+    // context for tracking async events, shared by the steps of one operation, which finishes along with it
     struct AsyncEventContext
     {
-        AsyncEventContext(PluginHost& host) : m_host(&host) { m_host->m_asyncEventCount.fetch_add(1); }
-        ~AsyncEventContext() { if (m_host) m_host->m_asyncEventCount.fetch_sub(1); }
+        AsyncEventContext(PluginHost& host, std::shared_ptr<AsyncOperation> operation)
+            : m_host(&host), m_operation(std::move(operation)) { m_host->m_asyncEventCount.fetch_add(1); }
+        ~AsyncEventContext()
+        {
+            m_operation->finish();
+            if (m_host) m_host->asyncEventFinished();
+        }
 
         AsyncEventContext(const AsyncEventContext&) = delete;
         AsyncEventContext& operator=(const AsyncEventContext&) = delete;
         AsyncEventContext(AsyncEventContext&& other) = delete;
         AsyncEventContext& operator=(AsyncEventContext&& other) = delete;
 
+        // true if the operation was cancelled, the step should return without doing anything
+        bool cancelled() { return m_operation->shouldStop(); }
+        // print the error and report it as the operation's failure
+        void fail(const std::string& error);
+
         PluginHost* m_host = nullptr;
+        std::shared_ptr<AsyncOperation> m_operation;
     };
-    // create an async event context
+    // create an async event context for a new operation (VM thread)
     std::shared_ptr<AsyncEventContext> createAsyncEventContext();
+    // count down m_asyncEventCount, waking waitForAsyncEvents() at 0
+    void asyncEventFinished();
+    // keep a ChucK object the message thread uses for an operation alive until it has finished (VM thread)
+    void holdObject(Chuck_Object * object, std::shared_ptr<AsyncOperation> operation);
+    // broadcast the PluginOp objects of finished operations, then let go of them and of the held objects (tick)
+    void updateOperationObjects();
 
     // ensure that the process is a foreground process (Mac only)
     void ensureForegroundProcess();
 
     // call a function on the main thread, either synchonously or asynchronously
-    void callOnMainThread(std::function<void()> func);
+    // Goes through the preallocated command queue (see MessageThread.h), func is stored as is.
+    template <typename Func>
+    void callOnMainThread(Func&& func)
+    {
+        static_assert(MessageCommands::fitsSlot<std::decay_t<Func>>(),
+                      "host commands must fit a command slot, capture a shared_ptr to anything bigger");
+        m_numQueuedCommands++;
+        if (m_forceSynchronous)
+            callOnMessageThreadSync(std::forward<Func>(func));
+        else
+            callOnMessageThread(std::forward<Func>(func));
+    }
+
+    // Host operations where only the last of a burst matters (e.g. stepping through presets). They are
+    // queued as typed commands, and one of them merges into the command this host queued last if that is
+    // of the same kind and stage and hasn't started yet, taking over its payload. The operation of the
+    // merged call never runs and is reported as cancelled. Nothing merges in synchronous mode.
+    enum class CommandKind
+    {
+        program,
+        blockSize,
+        editor,
+        loadState
+    };
+    struct CoalescedCommand
+    {
+        CommandKind kind = CommandKind::program;
+        int stage = 0;
+        // payload of the latest call: program index, block size or editor shown / hidden, and state file
+        int value = 0;
+        std::string path;
+        std::shared_ptr<AsyncEventContext> context;
+        // taken by the message thread, too late to merge into
+        bool started = false;
+    };
+    // queue a command or merge it into the last one (VM thread)
+    void queueCoalesced(CommandKind kind, int stage, int value, const std::string& path, std::shared_ptr<AsyncEventContext> context);
+    // carry out the latest payload of a command (message thread)
+    void runCoalesced(CommandKind kind, int stage, int value, const std::string& path, AsyncEventContext& context);
+    // open the editor window of a stage or bring it to the front (message thread)
+    void openEditor(int stage);
+
+    // the coalesced command queued last, and the value of m_numQueuedCommands right after it was queued
+    std::mutex m_coalesceMutex;
+    std::shared_ptr<CoalescedCommand> m_lastCoalesced;
+    uint64_t m_lastCoalescedSerial = 0;
+    // calls to callOnMainThread
+    std::atomic<uint64_t> m_numQueuedCommands { 0 };
+    std::atomic<int> m_numMergedCommands { 0 };
 
     // number of currently running asynchronous events
     std::atomic<int> m_asyncEventCount { 0 };
+    // notified when m_asyncEventCount drops to 0
+    mutable std::mutex m_asyncEventMutex;
+    mutable std::condition_variable m_asyncEventsDone;
+    // operation started last (VM thread)
+    std::shared_ptr<AsyncOperation> m_lastOperation;
+    // PluginOp objects handed to the shreds, with a reference held until they were broadcast (VM thread)
+    struct OperationObject
+    {
+        std::shared_ptr<AsyncOperation> operation;
+        Chuck_Object * object = nullptr;
+        bool broadcast = false;
+    };
+    std::vector<OperationObject> m_operationObjects;
+    // ChucK objects referenced for the operations using them (VM thread, see holdObject)
+    struct HeldObject
+    {
+        std::shared_ptr<AsyncOperation> operation;
+        Chuck_Object * object = nullptr;
+    };
+    std::vector<HeldObject> m_heldObjects;
 
     // If true all main thread events will be force to be "synchronous" (i.e. blocking audio process until they finish).
     // This is simpler for user (since they don't have to manage waiting for asynchronous events) and nice for debugging
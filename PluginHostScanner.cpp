@@ -0,0 +1,47 @@
+//-----------------------------------------------------------------------------
+// PluginHostScanner.cpp
+// Probes one plugin file in its own process, for PluginScanner:
+//   PluginHostScanner <format name> <file or identifier> <result file>
+// Writes the descriptions it finds to the result file as XML and exits with 0.
+// If the plugin crashes or hangs, only this process goes down.
+//-----------------------------------------------------------------------------
+
+#include <JuceHeader.h>
+
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "usage: PluginHostScanner <format> <file> <result file>" << std::endl;
+        return 2;
+    }
+
+    // some formats need a message manager to instantiate plugins
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::AudioPluginFormatManager formatManager;
+    formatManager.addDefaultFormats();
+
+    juce::AudioPluginFormat* format = nullptr;
+    for (auto* f : formatManager.getFormats())
+    {
+        if (f->getName() == argv[1])
+            format = f;
+    }
+    if (!format)
+    {
+        std::cerr << "PluginHostScanner: Unknown format " << argv[1] << std::endl;
+        return 2;
+    }
+
+    juce::OwnedArray<juce::PluginDescription> descriptions;
+    format->findAllTypesForFile(descriptions, argv[2]);
+
+    juce::XmlElement xml("PLUGINS");
+    for (auto* description : descriptions)
+        xml.addChildElement(description->createXml().release());
+
+    return xml.writeTo(juce::File(argv[3])) ? 0 : 1;
+}
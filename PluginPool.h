@@ -0,0 +1,105 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// PluginPool
+// Chugin-wide pool of plugin instances which are created, set up and prepared
+// ahead of time (see PluginHost::preload), so loading one mid-performance just
+// takes it from here instead of going through instantiation and preparation.
+// Instances are filed under their plugin file's full path (getKey), along with the sample
+// rate and block size they were prepared for. Added and taken on the message
+// thread, counts can be read from any thread.
+//-----------------------------------------------------------------------------
+class PluginPool
+{
+public:
+
+    struct Instance
+    {
+        std::unique_ptr<juce::AudioPluginInstance> plugin;
+        double sampleRate = 0.0;
+        int maxBlockSize = 0;
+    };
+
+    // the process-wide pool, created on first use
+    static std::shared_ptr<PluginPool> getShared()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<PluginPool> instance;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto pool = instance.lock();
+        if (!pool)
+        {
+            pool.reset(new PluginPool());
+            instance = pool;
+        }
+        return pool;
+    }
+
+    ~PluginPool()
+    {
+        // plugins are destroyed on the message thread, whichever thread lets go of the pool last
+        auto instances = std::make_shared<std::map<std::string, std::vector<Instance>>>(std::move(m_instances));
+        juce::MessageManager::callAsync([instances]() {});
+    }
+
+    // the key of a plugin file: its full path, anything that isn't an absolute path as it is. Every lookup
+    // goes through this, and a host's stages keep the key they were loaded under (for clone).
+    static std::string getKey(const juce::String& path)
+    {
+        if (!juce::File::isAbsolutePath(path))
+            return path.toStdString();
+        return juce::File(path).getFullPathName().toStdString();
+    }
+
+    void add(const std::string& path, Instance instance)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_instances[path].push_back(std::move(instance));
+    }
+
+    // take a prepared instance of the plugin, false if there is none
+    bool take(const std::string& path, Instance& instance)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_instances.find(path);
+        if (it == m_instances.end() || it->second.empty())
+            return false;
+
+        instance = std::move(it->second.back());
+        it->second.pop_back();
+        return true;
+    }
+
+    int getNumAvailable(const std::string& path) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_instances.find(path);
+        return it != m_instances.end() ? (int)it->second.size() : 0;
+    }
+
+    // destroy the pooled instances of a plugin, or of all plugins if path is empty
+    void clear(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (path.empty())
+            m_instances.clear();
+        else
+            m_instances.erase(path);
+    }
+
+private:
+
+    PluginPool() = default;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::vector<Instance>> m_instances;
+};
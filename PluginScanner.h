@@ -0,0 +1,247 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "PluginCatalog.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// PluginScanner
+// Scans the standard plugin directories of every registered format (plus any
+// extra ones) into the PluginCatalog. Each file is probed by the PluginHostScanner
+// executable in a child process, several at once, so a plugin that crashes or
+// hangs while being probed only takes its child down - it's blacklisted instead.
+// Files the catalog already knows in their current version aren't probed again.
+// One scan runs at a time, started and finished on the message thread.
+//-----------------------------------------------------------------------------
+class PluginScanner : private juce::Thread
+{
+public:
+
+    // a probe taking longer than this counts as hung
+    static constexpr int timeoutMs = 30000;
+
+    // Start scanning in the background, returns false if a scan is already running (message thread)
+    static bool start(const juce::StringArray& extraDirectories)
+    {
+        auto& active = getActive();
+        if (active)
+            return false;
+
+        const auto executable = getScannerExecutable();
+        if (!executable.existsAsFile())
+        {
+            std::cout << "PluginHost: Plugin scanner not found at " << executable.getFullPathName() << std::endl;
+            return false;
+        }
+
+        active.reset(new PluginScanner(PluginCatalog::getShared(), executable, extraDirectories));
+        getScanning() = true;
+        active->startThread();
+        return true;
+    }
+
+    // any thread
+    static bool isScanning() { return getScanning().load(); }
+
+    // stop a running scan, killing its probes (message thread)
+    static void shutdown()
+    {
+        getActive().reset();
+        getScanning() = false;
+    }
+
+    // the scanner executable is installed next to the chugin
+    static juce::File getScannerExecutable()
+    {
+#if JUCE_WINDOWS
+        const char* name = "PluginHostScanner.exe";
+#else
+        const char* name = "PluginHostScanner";
+#endif
+        // from within a shared library this is the library, not the ChucK executable
+        return juce::File::getSpecialLocation(juce::File::currentExecutableFile).getSiblingFile(name);
+    }
+
+    ~PluginScanner() override
+    {
+        stopThread(timeoutMs);
+    }
+
+private:
+
+    struct Probe
+    {
+        juce::String formatName;
+        juce::String path;
+        juce::File resultFile;
+        std::unique_ptr<juce::ChildProcess> process;
+        juce::uint32 startTime = 0;
+        // filled in by the scan thread once the probe is done
+        bool failed = false;
+        juce::OwnedArray<juce::PluginDescription> descriptions;
+    };
+
+    PluginScanner(std::shared_ptr<PluginCatalog> catalog, const juce::File& executable, const juce::StringArray& extraDirectories)
+        : juce::Thread("PluginHost Plugin Scanner"), m_catalog(std::move(catalog)), m_executable(executable)
+    {
+        // gather the files up front, the catalog is only touched on the message thread
+        for (auto* format : m_catalog->getFormatManager().getFormats())
+        {
+            auto directories = format->getDefaultLocationsToSearch();
+            for (auto& directory : extraDirectories)
+                directories.addIfNotAlreadyThere(juce::File(directory));
+
+            for (auto& path : format->searchPathsForPlugins(directories, true, true))
+            {
+                const juce::File file(path);
+                if (m_catalog->isBlacklisted(path) || m_catalog->isUpToDate(file))
+                    continue;
+
+                auto probe = std::make_unique<Probe>();
+                probe->formatName = format->getName();
+                probe->path = path;
+                m_probes.push_back(std::move(probe));
+            }
+        }
+    }
+
+    static std::unique_ptr<PluginScanner>& getActive()
+    {
+        static std::unique_ptr<PluginScanner> active;
+        return active;
+    }
+
+    static std::atomic<bool>& getScanning()
+    {
+        static std::atomic<bool> scanning { false };
+        return scanning;
+    }
+
+    void run() override
+    {
+        const int maxRunning = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        size_t next = 0;
+        std::vector<Probe*> running;
+
+        while (!threadShouldExit() && (next < m_probes.size() || !running.empty()))
+        {
+            while ((int)running.size() < maxRunning && next < m_probes.size())
+            {
+                auto* probe = m_probes[next++].get();
+                if (launch(*probe))
+                    running.push_back(probe);
+                else
+                    probe->failed = true;
+            }
+
+            for (auto it = running.begin(); it != running.end();)
+            {
+                if (poll(**it))
+                    it = running.erase(it);
+                else
+                    ++it;
+            }
+            wait(10);
+        }
+
+        // stopped early (shutdown), nothing is handed to the catalog
+        if (threadShouldExit())
+        {
+            for (auto* probe : running)
+            {
+                probe->process->kill();
+                probe->resultFile.deleteFile();
+            }
+            return;
+        }
+
+        juce::MessageManager::callAsync([this]
+        {
+            // unless the scan was shut down in the meantime
+            if (getActive().get() != this)
+                return;
+            finish();
+            shutdown();
+        });
+    }
+
+    bool launch(Probe& probe)
+    {
+        probe.resultFile = juce::File::createTempFile(".xml");
+        probe.process = std::make_unique<juce::ChildProcess>();
+        probe.startTime = juce::Time::getMillisecondCounter();
+
+        // the probe's output isn't read, plugins printing a lot would otherwise fill the pipe and block it
+        const juce::StringArray args { m_executable.getFullPathName(), probe.formatName, probe.path, probe.resultFile.getFullPathName() };
+        return probe.process->start(args, 0);
+    }
+
+    // true once the probe is done, successfully or not
+    bool poll(Probe& probe)
+    {
+        if (probe.process->isRunning())
+        {
+            if (juce::Time::getMillisecondCounter() - probe.startTime < (juce::uint32)timeoutMs)
+                return false;
+
+            probe.process->kill();
+            probe.failed = true;
+        }
+        else if (probe.process->getExitCode() != 0)
+        {
+            probe.failed = true;
+        }
+        else if (auto xml = juce::XmlDocument::parse(probe.resultFile))
+        {
+            for (auto* pluginXml : xml->getChildIterator())
+            {
+                auto description = std::make_unique<juce::PluginDescription>();
+                if (description->loadFromXml(*pluginXml))
+                    probe.descriptions.add(description.release());
+            }
+        }
+        else
+        {
+            probe.failed = true;
+        }
+
+        probe.resultFile.deleteFile();
+        probe.process.reset();
+        return true;
+    }
+
+    // hand the results to the catalog (message thread)
+    void finish()
+    {
+        int numFound = 0, numFailed = 0;
+        for (auto& probe : m_probes)
+        {
+            if (probe->failed)
+            {
+                std::cout << "PluginHost: Scanning " << probe->path << " failed, blacklisted" << std::endl;
+                m_catalog->addToBlacklist(probe->path);
+                numFailed++;
+            }
+            else
+            {
+                m_catalog->addScanResult(juce::File(probe->path), probe->descriptions);
+                numFound += probe->descriptions.size();
+            }
+        }
+        m_catalog->save();
+
+        std::cout << "PluginHost: Scanned " << m_probes.size() << " files, found " << numFound << " plugins";
+        if (numFailed > 0)
+            std::cout << ", " << numFailed << " blacklisted";
+        std::cout << std::endl;
+    }
+
+    std::shared_ptr<PluginCatalog> m_catalog;
+    juce::File m_executable;
+    std::vector<std::unique_ptr<Probe>> m_probes;
+};
@@ -2,33 +2,20 @@
 
 #include <JuceHeader.h>
 
+#include "MessageThread.h"
+
+#include <utility>
+
 
 // bad practice, but is convenient and can be ok
-inline void callOnMessageThreadSync(std::function<void()> func)
+template <typename Func>
+void callOnMessageThreadSync(Func&& func)
 {
-    jassert(func);
-    
-    if (juce::MessageManager::existsAndIsCurrentThread())
-    {
-        func();
-        return;
-    }
-
-    juce::WaitableEvent event;
-    juce::MessageManager::callAsync([func, &event]()
-    {
-        func();
-        event.signal();
-    });
-    event.wait();
+    MessageCommands::callSync(std::forward<Func>(func));
 }
 
-inline void callOnMessageThread(std::function<void()> func)
+template <typename Func>
+void callOnMessageThread(Func&& func)
 {
-    jassert(func);
-
-    if (juce::MessageManager::existsAndIsCurrentThread())
-        func();
-    else
-        juce::MessageManager::callAsync(func);
+    MessageCommands::call(std::forward<Func>(func));
 }
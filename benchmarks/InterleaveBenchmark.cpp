@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// InterleaveBenchmark.cpp
+// Compares the scalar reference transpose against the SIMD kernels in Interleave.h.
+// Build with -DPLUGINHOST_BUILD_BENCHMARKS=ON (add -mavx2 to test the AVX2 path).
+//-----------------------------------------------------------------------------
+
+#include "../Interleave.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    constexpr int numIterations = 200000;
+
+    template <typename Func>
+    double timeNs(Func&& func)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numIterations; i++)
+            func();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / numIterations;
+    }
+
+    template <int NumChannels>
+    bool run(int stride, int numFrames)
+    {
+        std::vector<float> in((size_t)(numFrames * stride));
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = std::sin((float)i);
+
+        std::vector<std::vector<float>> planarRef(NumChannels, std::vector<float>((size_t)numFrames));
+        std::vector<std::vector<float>> planar(NumChannels, std::vector<float>((size_t)numFrames));
+        float* refPtrs[NumChannels];
+        float* ptrs[NumChannels];
+        for (int c = 0; c < NumChannels; c++)
+        {
+            refPtrs[c] = planarRef[(size_t)c].data();
+            ptrs[c] = planar[(size_t)c].data();
+        }
+        std::vector<float> outRef(in.size(), 0.0f), out(in.size(), 0.0f);
+
+        // correctness
+        interleave::scalar::deinterleave<NumChannels>(in.data(), stride, refPtrs, 0, numFrames);
+        interleave::deinterleave<NumChannels>(in.data(), stride, ptrs, numFrames);
+        interleave::scalar::interleave<NumChannels>(refPtrs, outRef.data(), stride, 0, numFrames);
+        interleave::interleave<NumChannels>(ptrs, out.data(), stride, numFrames);
+        bool ok = planar == planarRef && out == outRef;
+
+        // timing
+        const double scalarDe = timeNs([&] { interleave::scalar::deinterleave<NumChannels>(in.data(), stride, refPtrs, 0, numFrames); });
+        const double simdDe = timeNs([&] { interleave::deinterleave<NumChannels>(in.data(), stride, ptrs, numFrames); });
+        const double scalarIn = timeNs([&] { interleave::scalar::interleave<NumChannels>(refPtrs, outRef.data(), stride, 0, numFrames); });
+        const double simdIn = timeNs([&] { interleave::interleave<NumChannels>(ptrs, out.data(), stride, numFrames); });
+
+        std::printf("%d ch  stride %d  %4d frames | deinterleave %8.1f ns -> %8.1f ns (x%.2f) | interleave %8.1f ns -> %8.1f ns (x%.2f) | %s\n",
+                    NumChannels, stride, numFrames,
+                    scalarDe, simdDe, scalarDe / simdDe,
+                    scalarIn, simdIn, scalarIn / simdIn,
+                    ok ? "ok" : "MISMATCH");
+        return ok;
+    }
+}
+
+int main()
+{
+#if PLUGINHOST_INTERLEAVE_AVX2
+    std::printf("kernels: AVX2 + SSE\n");
+#elif PLUGINHOST_INTERLEAVE_SSE
+    std::printf("kernels: SSE\n");
+#elif PLUGINHOST_INTERLEAVE_NEON
+    std::printf("kernels: NEON\n");
+#else
+    std::printf("kernels: scalar only\n");
+#endif
+
+    bool ok = true;
+    for (int numFrames : { 16, 64, 256, 13 })
+    {
+        // packed frames, the 8-float frames ChucK hands to PluginHost::tick (inputs and outputs),
+        // and 16-float frames for strides wider than the widest kernel
+        ok &= run<1>(1, numFrames); ok &= run<1>(8, numFrames); ok &= run<1>(16, numFrames);
+        ok &= run<2>(2, numFrames); ok &= run<2>(8, numFrames); ok &= run<2>(16, numFrames);
+        ok &= run<4>(4, numFrames); ok &= run<4>(8, numFrames); ok &= run<4>(16, numFrames);
+        ok &= run<8>(8, numFrames); ok &= run<8>(16, numFrames);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+// midi_output.ck
+
+// an arpeggiator generating MIDI, driving a synth
+PluginHost arp;
+PluginHost synth => dac;
+arp.load("/Library/Audio/Plug-Ins/Components/Cthulhu.component");
+synth.load("/Library/Audio/Plug-Ins/VST3/Pianoteq 8.vst3");
+
+// MIDI effects still have to tick to process
+arp => blackhole;
+
+// the arpeggiator's notes go straight to the synth
+arp.forwardMidi(synth);
+
+// and are printed as well
+fun void printMidi()
+{
+    while (true)
+    {
+        arp.midiOut() => now;
+        while (arp.recvMidiOut())
+            <<< "MIDI out:", arp.midiOutData(0), arp.midiOutData(1), arp.midiOutData(2), arp.midiOutTime() >>>;
+    }
+} spork ~printMidi();
+
+// hold a chord
+while (true)
+{
+    arp.noteOn([60, 64, 67], 0.7);
+    2::second => now;
+
+    arp.noteOff([60, 64, 67]);
+    1::second => now;
+}
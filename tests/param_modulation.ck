@@ -43,8 +43,8 @@ fun void displayParamValue()
 // Show editor
 plugin.showEditor();
 
-// LFO Modulation loop
-while (true)
+// LFO Modulation loop, stepping the parameter from a shred
+repeat (800)
 {
     // 0.5 Hz Sine wave mapped to [0.0, 1.0]
     (Math.sin(now / second * Math.PI) + 1.0) / 2.0 => float val;
@@ -52,3 +52,24 @@ while (true)
     
     10::ms => now;
 }
+
+// the same LFO run by the host on the audio thread, smooth and without waking up the shred
+plugin.paramLFO(paramIdx, PluginHost.LFO_SINE, 0.5, 0.5, 0.5);
+8::second => now;
+
+// ramp down and back up, then through a few steps
+plugin.stopParam(paramIdx);
+plugin.param(paramIdx, 0.0, 2::second);
+2::second => now;
+plugin.paramExp(paramIdx, 1.0, 2::second);
+2::second => now;
+plugin.paramSegments(paramIdx, [0.25, 0.75, 0.5], [1::second, 500::ms, 1::second]);
+2.5::second => now;
+
+// follow a ChucK signal through modulation input 0
+SinOsc lfo => PluginMod mod => plugin;
+0.25 => lfo.freq;
+plugin.modInput(mod);
+plugin.modulate(0, paramIdx, 0.5, 0.4);
+
+while (true) 1::second => now;
@@ -0,0 +1,35 @@
+// plugin_chain_ugen.ck
+
+// one UGen, plugins processed back to back
+PluginChain chain => dac;
+
+// Synth first, then effects
+chain.add("/Library/Audio/Plug-Ins/VST3/Pianoteq 8.vst3");
+chain.add("/Library/Audio/Plug-Ins/Components/EchoBoyJr.component");
+
+<<< "Stages:", chain.size() >>>;
+for (0 => int i; i < chain.size(); i++)
+    <<< i, chain.name(i), chain.numParams(i), "params" >>>;
+
+// Repeat a simple chord (MIDI goes to the first stage)
+fun void play()
+{
+    while (true)
+    {
+        chain.noteOn(60, 0.7);
+        chain.noteOn(64, 0.7);
+        chain.noteOn(67, 0.7);
+        1::second => now;
+        
+        chain.allNotesOff();
+        1::second => now;
+    }
+} spork ~play();
+
+// Toggle the echo every few seconds
+while (true)
+{
+    4::second => now;
+    chain.stageBypass(1, !chain.stageBypass(1));
+    <<< "Echo bypassed:", chain.stageBypass(1) >>>;
+}
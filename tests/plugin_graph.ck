@@ -0,0 +1,42 @@
+// plugin_graph.ck
+
+PluginGraph graph => dac;
+
+// nodes are numbered in the order they're added
+graph.add("/Library/Audio/Plug-Ins/VST3/Pianoteq 8.vst3");           // 0
+graph.add("/Library/Audio/Plug-Ins/Components/EchoBoyJr.component"); // 1
+graph.add("/Library/Audio/Plug-Ins/VST3/ValhallaSupermassive.vst3"); // 2
+
+// MIDI from the shred into the synth
+graph.connectMidi(PluginGraph.IN, 0);
+
+// synth -> echo and reverb in parallel -> out, plus the dry synth
+graph.connect(0, 1);
+graph.connect(0, 2);
+graph.connect(1, PluginGraph.OUT);
+graph.connect(2, PluginGraph.OUT);
+graph.connect(0, PluginGraph.OUT);
+
+// feedback loops are refused
+graph.connect(2, 0);
+
+// Repeat a simple chord
+fun void play()
+{
+    while (true)
+    {
+        graph.noteOn(60, 0.7);
+        graph.noteOn(64, 0.7);
+        graph.noteOn(67, 0.7);
+        1::second => now;
+        
+        graph.allNotesOff();
+        1::second => now;
+    }
+} spork ~play();
+
+// drop the dry signal after a while
+8::second => now;
+graph.disconnect(0, PluginGraph.OUT);
+
+while (true) 1::second => now;